@@ -191,6 +191,7 @@ typedef struct {
 #define SHT_SYMTAB_SHNDX  18		/* Extended section indeces */
 #define	SHT_NUM		  19		/* Number of defined types.  */
 #define SHT_LOOS	  0x60000000	/* Start OS-specific.  */
+#define SHT_LLVM_CALL_GRAPH_PROFILE 0x6fff4c09	/* LLVM call graph profile.  */
 #define SHT_GNU_ATTRIBUTES 0x6ffffff5	/* Object attributes.  */
 #define SHT_GNU_HASH	  0x6ffffff6	/* GNU-style hash table.  */
 #define SHT_GNU_LIBLIST	  0x6ffffff7	/* Prelink library list */
@@ -222,11 +223,15 @@ typedef struct {
 #define SHF_GROUP	           (1 << 9)	/* Section is member of a group.  */
 #define SHF_TLS		           (1 << 10)	/* Section hold thread-local data.  */
 #define SHF_COMPRESSED	     (1 << 11)	/* Section with compressed data. */
+#define SHF_GNU_RETAIN	     (1 << 21)	/* Not to be GCed by the linker.  */
 #define SHF_MASKOS	         0x0ff00000	/* OS-specific.  */
 #define SHF_MASKPROC	       0xf0000000	/* Processor-specific */
 #define SHF_ORDERED	         (1 << 30)	/* Special ordering requirement (Solaris).  */
 #define SHF_EXCLUDE	         (1U << 31)	/* Section is excluded unless referenced or allocated (Solaris).*/
 
+/* Section group handling.  */
+#define GRP_COMDAT	0x1		/* Mark group as COMDAT.  */
+
 /* special section indexes */
 #define SHN_UNDEF	0		/* Undefined section */
 #define SHN_LORESERVE	0xff00		/* Start of reserved indices */
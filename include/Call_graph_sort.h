@@ -0,0 +1,13 @@
+#pragma once
+#include <unordered_map>
+#include "Linking_context.h"
+
+// order executable input sections by the call graph profile with the C3 heuristic, hot callers and
+// callees are clustered together, it's copied from lld (ELF/CallGraphSort.cpp)
+namespace nCall_graph_sort
+{
+    // the priority of each section which is in a call graph edge, a section with a smaller priority
+    // is placed before. Edges are read from the .llvm.call-graph-profile sections of input files,
+    // and from --call-graph-ordering-file. It's empty if there is no edge
+    std::unordered_map<const Input_section*, std::size_t> Compute_section_order(const Linking_context &ctx);
+}
@@ -1,6 +1,10 @@
 #pragma once
+#include <vector>
 #include "Chunk/Chunk.h"
 
+struct Symbol;
+class Input_file;
+
 class Got_section final : public Chunk
 {
 public:
@@ -10,10 +14,20 @@ public:
         this->shdr.sh_type = SHT_PROGBITS;
         this->shdr.sh_flags = SHF_ALLOC | SHF_WRITE;
         this->shdr.sh_addralign = sizeof(Elf64_Addr); // 8 for 64 bit target, 4 for 32 bit
-
-        // We always create a .got so that _GLOBAL_OFFSET_TABLE_ has
-        // something to point to. s390x psABI define GOT[1] as a
-        // reserved slot, so we allocate one more for them.
-        this->shdr.sh_size = 8;
     }
-};
\ No newline at end of file
+
+    // a .got is only created if there is any symbol referred through it, 
+    // GOT loads of symbols defined in the output are relaxed, they don't need slots
+    struct Entry
+    {
+        Symbol *sym;
+        // the file which refers to 'sym', a local symbol is resolved in this file
+        const Input_file *file;
+    };
+
+    void Add_symbol(Symbol &sym, const Input_file &file);
+
+    uint64_t Get_slot_addr(const Symbol &sym) const;
+
+    std::vector<Entry> entry_list;
+};
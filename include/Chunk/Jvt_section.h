@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include "Chunk/Chunk.h"
+
+struct Symbol;
+class Input_file;
+
+// The jump vector table of the Zcmt extension, the JVT CSR is set to __jvt_base$ by the startup code.
+// `cm.jt index` jumps to the address in the entry at 'index', and `cm.jalt index` links ra as well.
+// Entries for cm.jt are at [0, 32), entries for cm.jalt are at [32, 256).
+class Jvt_section final : public Chunk
+{
+public:
+    static constexpr std::size_t gJT_ENTRY_CNT = 32;
+    static constexpr std::size_t gMAX_ENTRY_CNT = 256;
+
+    Jvt_section():Chunk(".riscv.jvt", false)
+    {
+        this->shdr.sh_type = SHT_PROGBITS;
+        this->shdr.sh_flags = SHF_ALLOC;
+        this->shdr.sh_addralign = 64;
+    }
+
+    struct Entry
+    {
+        Symbol *sym;
+        // the file which refers to 'sym', a local symbol is resolved in this file
+        const Input_file *file;
+    };
+
+    // index of the table entry of 'sym' for a tail call (rd is x0) or for a call (rd is ra), 
+    // -1 if there is no entry for it
+    int32_t Get_index(const Symbol &sym, bool is_link) const
+    {
+        auto &index_map = is_link ? jalt_index_map : jt_index_map;
+        auto it = index_map.find(&sym);
+        return it == index_map.end() ? -1 : (int32_t)it->second;
+    }
+
+    // unused entries between the last cm.jt entry and the first cm.jalt entry have null 'sym'
+    std::vector<Entry> entry_list;
+    std::unordered_map<const Symbol*, uint32_t> jt_index_map;
+    std::unordered_map<const Symbol*, uint32_t> jalt_index_map;
+};
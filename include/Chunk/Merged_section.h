@@ -2,6 +2,7 @@
 #include <string_view>
 #include <unordered_map>
 #include <memory>
+#include <atomic>
 
 #include "elf/ELF.h"
 #include "Chunk/Chunk.h"
@@ -28,16 +29,17 @@ public:
 
     struct Piece
     {
-        Piece(Merged_section &output_section, bool is_alive)
-            : output_section(output_section),
-              is_alive(is_alive){}
+        Piece(Merged_section &output_section)
+            : output_section(output_section){}
                          
         uint64_t Get_addr() const {return output_section.shdr.sh_addr + offset;}
         
         Merged_section &output_section;
         uint32_t offset = -1;
         uint32_t p2align = 0;
-        bool is_alive = false;
+        // pieces are alive unless --gc-sections finds that no live section refers them,
+        // it's set by the parallel mark phase of --gc-sections
+        std::atomic<bool> is_alive = true;
     };
     
 private:
@@ -48,9 +50,7 @@ private:
 inline Merged_section::Piece* 
 Merged_section::Insert(std::string_view key, uint64_t hash, uint32_t p2align)
 {
-    bool is_alive = !(this->shdr.sh_flags & SHF_ALLOC);
-
-    auto *frag = m_map.insert(std::make_pair(key, std::make_unique<Piece>(*this, is_alive))).first->second.get();
+    auto *frag = m_map.insert(std::make_pair(key, std::make_unique<Piece>(*this))).first->second.get();
     
     frag->p2align = std::max(frag->p2align, p2align);
 
@@ -1,5 +1,8 @@
 #pragma once
 #include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
 
 #include "Chunk/Chunk.h"
 #include "elf/ELF.h"
@@ -28,13 +31,60 @@ struct Output_section_key
 class Output_section final : public Chunk
 {
 public:
-    Output_section(Output_section_key key) : Chunk(key.name, false), type(key.type){}
+    Output_section(Output_section_key key) : Chunk(key.name, false), type(key.type)
+    {
+        shdr.sh_type = key.type;
+    }
     uint64_t type;
     struct Member
     {
         const Input_section* isec;
         const Input_file *file;
         std::size_t offset;
+        // --cache-line-isolate, nothing else shares a cache line with this member
+        bool is_isolated = false;
+        // --function-alignment, the function at the beginning of the member is aligned to it
+        uint64_t entry_alignment = 1;
     };
     std::vector<Member> member_list;
+
+    // padding bytes added by Member::entry_alignment on the current layout
+    std::size_t entry_alignment_padding = 0;
+
+    // Range extension thunks, `auipc t1, <hi20>; jalr zero, <lo12>(t1)`, for jumps whose targets are 
+    // out of the range of JAL. Members are grouped into batches, thunks of a batch are placed 
+    // after its last member and shared by all members of the batch.
+    struct Thunk_batch
+    {
+        struct Entry
+        {
+            Symbol *sym;
+            // the file which refers to 'sym', a local symbol is resolved in this file
+            const Input_file *file;
+        };
+
+        std::size_t last_member_idx;
+        std::size_t offset = 0;
+        std::vector<Entry> entry_list;
+        std::unordered_map<const Symbol*, std::size_t> index_map;
+
+        uint64_t size() const {return entry_list.size() * gTHUNK_SIZE;}
+    };
+
+    static constexpr std::size_t gTHUNK_SIZE = 8;
+
+    // the batch which the member at 'member_idx' belongs to, nullptr if there is no batch
+    Thunk_batch* Get_thunk_batch(std::size_t member_idx)
+    {
+        auto it = std::lower_bound(thunk_batch_list.begin(), 
+                                   thunk_batch_list.end(), 
+                                   member_idx, 
+                                   [](const Thunk_batch &batch, std::size_t idx){return batch.last_member_idx < idx;});
+
+        return it == thunk_batch_list.end() ? nullptr : &*it;
+    }
+    const Thunk_batch* Get_thunk_batch(std::size_t member_idx) const {return const_cast<Output_section*>(this)->Get_thunk_batch(member_idx);}
+
+    // sorted by 'last_member_idx'
+    std::vector<Thunk_batch> thunk_batch_list;
 };
\ No newline at end of file
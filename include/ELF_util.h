@@ -137,6 +137,7 @@ inline std::string_view get_output_name(std::string_view name, uint64_t flags)
         ".text.", ".data.rel.ro.", ".data.", ".rodata.", ".bss.rel.ro.", ".bss.",
         ".init_array.", ".fini_array.", ".tbss.", ".tdata.", ".gcc_except_table.",
         ".ctors.", ".dtors.", ".gnu.warning.", ".openbsd.randomdata.",
+        ".sdata.", ".sbss.", ".srodata.",
     };
 
     for (std::string_view prefix : prefixes)
@@ -63,9 +63,14 @@ public:
     void Collect_mergeable_section_piece();
     void Resolve_sesction_pieces(Linking_context &ctx);
     void Compute_symtab_size(Linking_context &ctx);
+    // sort the relocation section at 'relsec_idx' by r_offset
+    void Sort_relocation(std::size_t relsec_idx) const;
 
     const std::vector<eRelocate_state>& relocate_state_list() const {return m_relocate_state_list;}
+    // the section at 'shndx' is not copied to the output, e.g. it's garbage-collected
+    void Discard_section(std::size_t shndx) {m_relocate_state_list[shndx] = eRelocate_state::no_need;}
     Input_section* Get_input_section(std::size_t shndx);
+    const Input_section* Get_input_section(std::size_t shndx) const {return const_cast<Input_file*>(this)->Get_input_section(shndx);}
     Input_section* Get_symbol_input_section(const Symbol &sym)
     {
         if (sym.piece() != nullptr)
@@ -1,9 +1,12 @@
 #pragma once
 #include <string_view>
+#include <vector>
 #include "elf/ELF.h"
 #include "ELF_util.h"
 #include "Relocatable_file.h"
 
+class Output_section;
+
 struct Input_section
 {
 public:
@@ -41,9 +44,33 @@ public:
     nELF_util::ELF_Rel rela_at(std::size_t idx) const;
     std::string_view name() const ;
 
+    // the size of this section after linker relaxation
+    uint64_t size() const {return shdr().sh_size - (r_deltas.empty() ? 0 : r_deltas.back());}
+
+    // the number of bytes removed by linker relaxation before 'offset'
+    uint64_t Get_removed_bytes(uint64_t offset) const;
+
     Relocatable_file *rel_file;
     std::size_t shndx;
     std::string_view data;
+
+    // the output section which this section is placed in, and the offset from the begining of it
+    // they are set when input section offsets are assigned
+    mutable const Output_section *osec = nullptr;
+    mutable uint64_t osec_offset = 0;
+
+    // set by linker relaxation, r_deltas[i] is the number of bytes removed before the i-th relocation,
+    // and the last one is the total number of removed bytes. It's empty if nothing is removed
+    mutable std::vector<uint32_t> r_deltas;
+
+    // set by linker relaxation, sorted indexes of the relocations whose instructions are rewritten 
+    // because the sequences they belong to are relaxed, that is R_RISCV_LO12_I/S of removed LUIs 
+    // and calls of __tls_get_addr in TLS general-dynamic sequences
+    mutable std::vector<uint32_t> rewritten_rel_list;
+
+    // set by identical code folding, this section is not copied to the output 
+    // and its symbols are resolved in 'leader' which has the same contents
+    const Input_section *leader = nullptr;
     
 private:
     std::size_t m_relsec_idx;
@@ -72,6 +99,25 @@ inline nELF_util::ELF_Rel Input_section::rela_at(std::size_t idx) const
     return nELF_util::ELF_Rel{};
 }
 
+inline uint64_t Input_section::Get_removed_bytes(uint64_t offset) const
+{
+    if (r_deltas.empty() == true)
+        return 0;
+
+    // find the first relocation at or after 'offset', relocations are sorted by r_offset
+    std::size_t lo = 0, hi = m_rel_count;
+    while (lo < hi)
+    {
+        std::size_t mid = (lo + hi) / 2;
+
+        if (rela_at(mid).offset() < offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return r_deltas[lo];
+}
 
 inline std::string_view Input_section::name() const 
 {
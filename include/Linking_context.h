@@ -50,6 +50,80 @@ public:
         std::vector<path_of_file_t> obj_file;
         std::string output_file = "a.out";
         eLink_machine_optinon link_machine_optinon = eLink_machine_optinon::unknown;
+        // --relax/--no-relax, R_RISCV_ALIGN is always handled
+        bool relax = true;
+        // --relax-tbljal, rewrite calls to cm.jt/cm.jalt of the Zcmt extension
+        bool relax_tbljal = false;
+        // --relax-tbljal-threshold=<bytes>, the least estimated bytes saved by a jump table entry
+        int64_t relax_tbljal_threshold = 1;
+        // --print-table-jump, list entries of the jump table of --relax-tbljal to stderr
+        bool print_table_jump = false;
+        // --gc-sections/--no-gc-sections, discard allocated sections which are not reachable from the entry
+        bool gc_sections = false;
+        // --print-gc-sections, list sections discarded by --gc-sections
+        bool print_gc_sections = false;
+        // --icf=none|safe|all, identical code folding. 'safe' doesn't fold sections whose addresses are taken,
+        // 'all' folds read-only data sections as well
+        enum class eIcf_mode : uint8_t
+        {
+            none = 0,
+            safe,
+            all
+        };
+        eIcf_mode icf = eIcf_mode::none;
+        // --print-icf-sections, list sections folded by --icf and the statistics of folding to stderr
+        bool print_icf_sections = false;
+        // --symbol-ordering-file=<path>, sections which define the symbols listed in the file, 
+        // one name per line, are placed first in their output sections in the order of the file
+        std::string symbol_ordering_file;
+        // --call-graph-profile-sort/--no-call-graph-profile-sort, order sections by the call graph profile
+        bool call_graph_profile_sort = true;
+        // --call-graph-ordering-file=<path>, call graph edges, "<caller> <callee> <weight>" per line,
+        // in addition to .llvm.call-graph-profile sections of the input files
+        std::string call_graph_ordering_file;
+        // -z keep-text-section-prefix/-z nokeep-text-section-prefix, group .text.hot.*, .text.startup.*, 
+        // .text.exit.* and .text.unlikely.* in .text, the hot code first and the cold code last
+        bool keep_text_section_prefix = false;
+        // --data-access-profile=<path>, "<symbol> <access count>" per line, hot sections of .data, 
+        // .sdata, .bss and .sbss are placed first, so that hot objects share cache lines
+        std::string data_access_profile;
+        // --cache-line-isolate=<symbol>, the section which defines the symbol, e.g. a variable 
+        // written by many cores, occupies its own cache lines to avoid false sharing
+        std::vector<std::string> cache_line_isolate;
+        // --cache-line-size=<bytes>
+        uint64_t cache_line_size = 64;
+        // --sort-section=alignment, members of .rodata, .data, .bss and so on which are not ordered 
+        // by other options are placed from the largest alignment to the smallest to minimize padding
+        bool sort_section_alignment = false;
+        // --print-section-packing, report padding bytes saved by --sort-section=alignment
+        bool print_section_packing = false;
+        // --function-alignment=<bytes>, align function entries to the boundary, e.g. the fetch block 
+        // size of the core, 0 if functions are aligned as input sections are
+        uint64_t function_alignment = 0;
+        // --function-alignment-file=<path>, only functions listed in the file, one name per line,
+        // are aligned by --function-alignment
+        std::string function_alignment_file;
+        // --print-function-alignment, report the size cost of --function-alignment
+        bool print_function_alignment = false;
+        // -z hugepage-align/-z nohugepage-align, align the file offsets and the addresses of read-only and
+        // executable segments to huge pages, so that they can be mapped by transparent huge pages
+        bool hugepage_align = false;
+        // -n/--nmagic, segments are packed back to back instead of being page aligned, so they share 
+        // pages at their boundaries. -N/--omagic also makes text and data writable, so they are put
+        // into a single segment. Both are for images which are not loaded by demand paging
+        enum class eSegment_packing : uint8_t
+        {
+            page = 0,
+            nmagic,
+            omagic
+        };
+        eSegment_packing segment_packing = eSegment_packing::page;
+        // -z separate-code/-z noseparate-code, executable segments don't share pages with other 
+        // segments in memory and in the file. By default segments share a page in the file
+        bool separate_code = false;
+        // --zero-data-to-bss/--no-zero-data-to-bss, place .data and .sdata input sections which contain 
+        // only zeros and have no relocation in .bss and .sbss
+        bool zero_data_to_bss = false;
         int argc;
         char **argv;
     };
@@ -86,6 +160,7 @@ public:
         Symbol *init = nullptr;
 
         Symbol *global_pointer = nullptr;
+        Symbol *jvt_base = nullptr;
         Symbol *bss_start = nullptr;
         Symbol *end = nullptr;
         Symbol *_end = nullptr;
@@ -100,11 +175,13 @@ public:
         Symbol *init_array_end = nullptr;
         Symbol *fini_array_start = nullptr;
         Symbol *fini_array_end = nullptr;
+        Symbol *tls_get_addr = nullptr;
 
         std::string_view entry_name = "_start";
         std::string_view fiini_name = "_fini";
         std::string_view init_name = "_init";
         std::string_view global_pointer_name = "__global_pointer$";
+        std::string_view jvt_base_name = "__jvt_base$";
         std::string_view bss_start_name = "__bss_start";
         std::string_view end_name = "end";
         std::string_view _end_name = "_end";
@@ -119,6 +196,7 @@ public:
         std::string_view init_array_end_name = "__init_array_end";
         std::string_view fini_array_start_name = "__fini_array_start";
         std::string_view fini_array_end_name = "__fini_array_end";
+        std::string_view tls_get_addr_name = "__tls_get_addr";
     }special_symbols;
 
     void insert_object_file(Relocatable_file src, bool is_from_lib);
@@ -176,7 +254,7 @@ public:
 
     eLink_machine_optinon maching_option() const {return m_link_option_args.link_machine_optinon;}
 
-    Link_option_args link_option_args() const {return m_link_option_args;}
+    const Link_option_args& link_option_args() const {return m_link_option_args;}
     
     const std::unordered_map<std::string_view, linking_package>& global_symbol_map() const {return m_global_symbol_map;}
 
@@ -231,9 +309,15 @@ public:
     Strtab_section *strtab_section = nullptr;
     Riscv_attributes_section *riscv_attributes_section = nullptr;
     Got_section *got = nullptr;
+    Jvt_section *jvt = nullptr;
     uint64_t page_size = 1<<12;
+    // -z hugepage-align, the size of a transparent huge page
+    uint64_t huge_page_size = 1<<21;
     uint64_t image_base = 0x200000;
     uint64_t filesize = 0;
+    // the address which tp points to, it's the start of the TLS segment. 
+    // It's set with synthetic symbols after the layout
+    uint64_t tp_addr = 0;
     // maybe default -1 is not a robust way to representing a null value 
     uint64_t physical_image_base = (uint64_t)-1;
 
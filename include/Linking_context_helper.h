@@ -7,9 +7,14 @@ namespace nLinking_context_helper
     uint64_t to_phdr_flags(Linking_context &ctx, const Chunk &chunk);
     uint64_t Get_eflags(const Linking_context &ctx);
     bool Has_ctors_and_init_array(const Linking_context &ctx);
+    uint64_t Get_segment_alignment(Linking_context &ctx, const Chunk &chunk);
 
     inline uint64_t to_phdr_flags(Linking_context &ctx, const Chunk &chunk)
     {
+        // -N, text and data are in one writable segment
+        if (ctx.link_option_args().segment_packing == Linking_context::Link_option_args::eSegment_packing::omagic)
+            return (uint64_t)eSegment_flag::PF_R | (uint64_t)eSegment_flag::PF_W | (uint64_t)eSegment_flag::PF_X;
+
         bool write = (chunk.shdr.sh_flags & SHF_WRITE);
         bool exec = (chunk.shdr.sh_flags & SHF_EXECINSTR);
 
@@ -67,4 +72,19 @@ namespace nLinking_context_helper
 
         return x && y;
     }
+
+    // the alignment of the PT_LOAD segment which 'chunk' belongs to, with -z hugepage-align
+    // the read-only and executable segments are aligned to huge pages. It's 1 with -n/-N,
+    // segments are not aligned more than their sections
+    inline uint64_t Get_segment_alignment(Linking_context &ctx, const Chunk &chunk)
+    {
+        if (ctx.link_option_args().segment_packing != Linking_context::Link_option_args::eSegment_packing::page)
+            return 1;
+
+        if (   ctx.link_option_args().hugepage_align 
+            && (to_phdr_flags(ctx, chunk) & (uint64_t)eSegment_flag::PF_W) == 0)
+            return ctx.huge_page_size;
+
+        return ctx.page_size;
+    }
 }
\ No newline at end of file
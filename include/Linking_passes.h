@@ -7,31 +7,86 @@ namespace nLinking_passes
 {
     using Link_option_args = Linking_context::Link_option_args;
 
+    // the most bytes spanned by members of an output section which share the same range extension thunks
+    constexpr std::size_t gTHUNK_BATCH_SIZE = 512 * 1024;
+
     Output_section_key Get_output_section_key(const Linking_context &ctx, const Input_section &isec, bool ctors_in_init_array);
 
-    uint64_t Get_input_section_addr(const Linking_context &ctx, Input_section *isec);    
+    uint64_t Get_input_section_addr(const Linking_context &ctx, const Input_section *isec);    
+    // the address of 'offset' of an input section after linker relaxation
+    uint64_t Get_input_section_addr(const Linking_context &ctx, const Input_section *isec, uint64_t offset);
+
     uint64_t Get_global_symbol_addr(const Linking_context &ctx, const Symbol &sym, uint64_t flags = 0) ;
 
+    // the address of 'sym' which is referred by 'file', a local symbol is resolved in 'file'
+    uint64_t Get_symbol_addr(const Linking_context &ctx, const Input_file &file, const Symbol &sym);
+
+    // the input section where 'sym' is defined and the file of it, a local symbol is defined in 'file'
+    // which refers it. nullptr is returned for absolute or undefined symbols and mergeable section pieces
+    const Input_section* Get_defining_section(const Linking_context &ctx, const Input_file &file, const Symbol &sym, const Input_file **def_file);
+
     elf64_sym to_output_esym(Linking_context &ctx, Symbol &sym, uint32_t st_name, uint32_t *shndx);
 
+    // a COMDAT group is kept only in the first live file which has it, groups are put in a table concurrently, and
+    // members of the groups of the other files are discarded, their global symbols are bound to the owner's ones.
+    // It's called for the files given directly before global symbols are put, so that the groups are never owned by 
+    // library members which are not extracted, and again for groups which only library members have after extraction
+    void Resolve_comdat_groups(Linking_context &ctx, std::vector<Input_file> &input_file_list, const std::vector<bool> &is_alive);
+
     void Resolve_symbols(Linking_context &ctx, std::vector<Input_file> &input_file_list, std::vector<bool> &is_alive);
 
+    // --gc-sections, mark input sections and mergeable section pieces reachable from the entry 
+    // and retained sections over relocations in parallel, and discard unmarked allocated sections
+    void Gc_sections(Linking_context &ctx, std::vector<Input_file> &input_file_list);
+
+    // --icf, fold executable input sections, and read-only data sections with --icf=all, which have 
+    // the same contents and refer the same symbols, or sections folded together, through the same relocations. Equivalence classes
+    // are refined in parallel until they are stable, and each class is folded into one leader
+    void Fold_identical_sections(Linking_context &ctx, std::vector<Input_file> &input_file_list);
+
     void Reference_dependent_file(Input_file &input_file, 
                                   Linking_context &ctx,
                                   const std::function<void(const Input_file&)> &reference_file);
 
     void Check_duplicate_smbols(const Input_file &file);
+
+    // relocations of every input section are sorted by r_offset, relocation sections are sorted in parallel
+    void Sort_relocations(Linking_context &ctx);
     
-    // combine Input_section into Output_section
+    // combine Input_section into Output_section, with --zero-data-to-bss zero-filled data sections go to .bss/.sbss
     void Combined_input_sections(Linking_context &ctx);
 
+    // reorder members of each output section before their offsets are assigned, sections listed 
+    // by --symbol-ordering-file, or else ordered by the call graph profile, are placed first, 
+    // and the others are kept in the input order. With -z keep-text-section-prefix, sections are
+    // grouped by .text.hot, .text.unlikely and so on before that. Data sections which are accessed 
+    // more by --data-access-profile are placed first, and --cache-line-isolate members are marked.
+    // With --sort-section=alignment, the rest of data sections are sorted by alignment to minimize padding
+    void Sort_output_section_members(Linking_context &ctx);
+
+    // With --function-alignment, executable members which begin with a function, all of them or the 
+    // ones listed in --function-alignment-file, are aligned to the boundary. The padding is added
+    // by Assign_input_section_offset, so the relaxation and thunk passes see it on each layout
+    void Align_functions(Linking_context &ctx);
+
+    // --print-function-alignment, report the padding added by --function-alignment
+    void Print_function_alignment(const Linking_context &ctx);
+
     void Bind_special_symbols(Linking_context &ctx);
 
     void Create_synthetic_sections(Linking_context &ctx);
 
+    // scan GOT relocations of all files in parallel, and create .got if any symbol needs a GOT slot
+    void Create_got(Linking_context &ctx);
+
+    // With --relax-tbljal, count calls and tail calls to each function in parallel, and create 
+    // the Zcmt jump table for the functions which save the most bytes if they are called by table jumps
+    void Create_jvt(Linking_context &ctx);
+
     void Populate_symtab(Linking_context &ctx);
 
-    // after assigning input section offsets of Output_section, output section sizes are calculated
+    // after assigning input section offsets of Output_section, output section sizes are calculated,
+    // each member is aligned to its sh_addralign
     void Assign_input_section_offset(Linking_context &ctx);
 
     void Sort_output_sections(Linking_context &ctx);
@@ -41,6 +96,14 @@ namespace nLinking_passes
     // assign virtual addresses and file offsets to ouput chunks.
     [[nodiscard]] std::size_t Set_output_chunk_locations(Linking_context &ctx);
 
+    // One pass of linker relaxation on the current layout, it returns true if 
+    // the bytes removed from any section are changed, then the layout has to be recomputed.
+    [[nodiscard]] bool Relax_sections(Linking_context &ctx);
+
+    // JAL reaches PC ± 1 MiB, jumps to targets out of the range on the current layout are redirected 
+    // to range extension thunks, it returns true if any thunk is added, then the layout has to be recomputed.
+    [[nodiscard]] bool Create_thunks(Linking_context &ctx);
+
     void Fix_up_synthetic_symbols(Linking_context &ctx);
     
     void Relocate_symbols(Linking_context &ctx, Output_section &osec);
@@ -74,20 +137,23 @@ inline Output_section_key nLinking_passes::Get_output_section_key(const Linking_
     return Output_section_key{name, type};
 }
 
-inline uint64_t nLinking_passes::Get_input_section_addr(const Linking_context &ctx, Input_section *isec)
+inline uint64_t nLinking_passes::Get_input_section_addr(const Linking_context &ctx, const Input_section *isec)
 {
-    auto key = Get_output_section_key(ctx, *isec, nLinking_context_helper::Has_ctors_and_init_array(ctx));
+    if (isec->leader != nullptr)
+        isec = isec->leader; // folded by --icf
 
-    auto it = ctx.osec_pool().find(key);
-    
-    for(std::size_t i = 0 ; i < it->second->member_list.size() ; i++)
-    {
-        if (it->second->member_list[i].isec == isec)
-            return it->second->shdr.sh_addr + it->second->member_list[i].offset;
-    }
-    
-    FATALF("%s", "unreachable");
-    return 0;
+    if (isec->osec == nullptr)
+        FATALF("%s", "unreachable");
+
+    return isec->osec->shdr.sh_addr + isec->osec_offset;
+}
+
+inline uint64_t nLinking_passes::Get_input_section_addr(const Linking_context &ctx, const Input_section *isec, uint64_t offset)
+{
+    if (isec->leader != nullptr)
+        isec = isec->leader; // folded by --icf
+
+    return Get_input_section_addr(ctx, isec) + offset - isec->Get_removed_bytes(offset);
 }
 
 // copied from mold
@@ -117,6 +183,23 @@ inline uint64_t nLinking_passes::Get_global_symbol_addr(const Linking_context &c
 
     if (isec == nullptr)
         return sym.val; // absolute symbol
+
+    if (isec->osec == nullptr && isec->leader == nullptr)
+        return 0; // a non-alloc section refers a section discarded by --gc-sections
     
-    return Get_input_section_addr(ctx, isec) + sym.val;
-}
\ No newline at end of file
+    return Get_input_section_addr(ctx, isec, sym.val);
+}
+
+inline uint64_t nLinking_passes::Get_symbol_addr(const Linking_context &ctx, const Input_file &file, const Symbol &sym)
+{
+    if (sym.piece() != nullptr || nELF_util::Is_sym_local(sym.elf_sym()) == false)
+        return Get_global_symbol_addr(ctx, sym);
+
+    // a local symbol is defined in one of the sections of this file
+    const Input_section *target = file.Get_input_section(file.src().get_shndx(sym.elf_sym()));
+
+    if (target == nullptr)
+        return sym.val; // absolute symbol
+
+    return Get_input_section_addr(ctx, target, sym.val);
+}
@@ -14,6 +14,7 @@
 #include "Chunk/Symtab_section.h"
 #include "Chunk/Riscv_attributes_section.h"
 #include "Chunk/Got_section.h"
+#include "Chunk/Jvt_section.h"
 
 class Linking_context;
 
@@ -96,4 +97,10 @@ template<>
 Output_chunk::Output_chunk<Symtab_section>(Symtab_section *sec, Linking_context &ctx);
 
 template<>
-Output_chunk::Output_chunk<Symtab_shndx_section>(Symtab_shndx_section *sec, Linking_context &ctx);
\ No newline at end of file
+Output_chunk::Output_chunk<Symtab_shndx_section>(Symtab_shndx_section *sec, Linking_context &ctx);
+
+template<>
+Output_chunk::Output_chunk<Got_section>(Got_section *got, Linking_context &ctx);
+
+template<>
+Output_chunk::Output_chunk<Jvt_section>(Jvt_section *jvt, Linking_context &ctx);
\ No newline at end of file
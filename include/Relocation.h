@@ -0,0 +1,31 @@
+#pragma once
+#include <vector>
+#include "Linking_context.h"
+
+// copy input sections into the output buffer and apply RISC-V relocations to them,
+// both are done in one pass over an input section
+namespace nRelocation
+{
+    void Reloc_alloc(Linking_context &ctx, Output_section &osec, std::size_t isec_idx);
+
+    void Reloc_non_alloc(Linking_context &ctx, Output_section &osec, std::size_t isec_idx);
+
+    // compute bytes removed by linker relaxation from an executable input section on the current layout, 
+    // 'r_deltas' and 'rewritten_rel_list' are filled in the format of the members of Input_section
+    void Relax_section(Linking_context &ctx, const Output_section &osec, std::size_t isec_idx, bool relax, 
+                       std::vector<uint32_t> &r_deltas, std::vector<uint32_t> &rewritten_rel_list);
+
+    // whether the GOT load of the R_RISCV_GOT_HI20 at 'rel_idx' is relaxed to a PC relative 
+    // address computation, a GOT slot is not needed for it if so
+    bool Is_got_relaxable(const Linking_context &ctx, const Input_file &file, const Input_section &isec, std::size_t rel_idx);
+
+    // the target of the call at 'rel_idx' if it can be rewritten to a table jump, or nullptr. 
+    // 'is_link' is set to true for a call (cm.jalt), and false for a tail call (cm.jt)
+    Symbol* Get_table_jump_target(const Linking_context &ctx, const Input_file &file, const Input_section &isec, std::size_t rel_idx, bool *is_link);
+
+    // collect targets of jumps in an input section which are out of the range of JAL on the current layout
+    void Scan_thunk_targets(Linking_context &ctx, const Output_section &osec, std::size_t isec_idx, std::vector<Output_section::Thunk_batch::Entry> &target_list);
+
+    // write the range extension thunks of 'batch' into the output buffer
+    void Write_thunks(Linking_context &ctx, const Output_section &osec, const Output_section::Thunk_batch &batch);
+}
@@ -45,4 +45,6 @@ public:
     std::string_view name;
     Elf64_Addr val;
     bool write_to_symtab = false;
+    // index of the GOT slot of this symbol, -1 if it has no slot
+    int32_t got_idx = -1;
 };
\ No newline at end of file
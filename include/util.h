@@ -1,10 +1,19 @@
 #pragma once
 #include <cstddef>
+#include <algorithm>
 #include <math.h>
 #include <assert.h>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 #include "stdlib.h"
 #include "stdio.h"
+#include "string.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define FATALF(fmt, ...) (fprintf(stderr, "fatal: %s:%d\n" fmt, __FILE__, __LINE__, ##__VA_ARGS__), abort())
 
@@ -145,6 +154,63 @@ inline void Overwrite_uleb(uint8_t *loc, uint64_t val)
     *loc = val & 0b0111'1111;
 }
 
+// Copy data with non-temporal stores if they are supported. The copied data bypass 
+// the cache, so it's used for large data which will not be touched again soon.
+inline void Stream_copy(void *dst, const void *src, std::size_t size)
+{
+#if defined(__SSE2__)
+    uint8_t *d = (uint8_t*)dst;
+    const uint8_t *s = (const uint8_t*)src;
+
+    // non-temporal stores need a 16 bytes aligned destination
+    std::size_t head = std::min<std::size_t>((16 - ((uintptr_t)d & 15)) & 15, size);
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    size -= head;
+
+    for (; size >= 16 ; size -= 16, d += 16, s += 16)
+        _mm_stream_si128((__m128i*)d, _mm_loadu_si128((const __m128i*)s));
+
+    memcpy(d, s, size);
+    _mm_sfence();
+#else
+    memcpy(dst, src, size);
+#endif
+}
+
+// call f(i) for every i in [0, n) on all hardware threads, an index is taken by the
+// first idle thread, so a few large jobs don't keep other threads waiting
+template<typename Func>
+void Parallel_for(std::size_t n, const Func &f)
+{
+    std::size_t n_thread = std::min<std::size_t>(n, std::max(1u, std::thread::hardware_concurrency()));
+
+    if (n_thread <= 1)
+    {
+        for(std::size_t i = 0 ; i < n ; i++)
+            f(i);
+        return;
+    }
+
+    std::atomic<std::size_t> next{0};
+
+    auto worker = [&]()
+    {
+        for(std::size_t i = next++ ; i < n ; i = next++)
+            f(i);
+    };
+
+    std::vector<std::thread> thread_list;
+    for(std::size_t i = 1 ; i < n_thread ; i++)
+        thread_list.emplace_back(worker);
+    
+    worker();
+
+    for(auto &t : thread_list)
+        t.join();
+}
+
 inline std::size_t Write_string(void *buf, std::string_view str)
 {
     memcpy(buf, str.data(), str.size());
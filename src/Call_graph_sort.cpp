@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <numeric>
+#include <fstream>
+#include <sstream>
+#include <map>
+
+#include "Call_graph_sort.h"
+#include "Linking_passes.h"
+#include "ELF_util.h"
+
+// copied from lld, the C3 heuristic is described in "Optimizing Function Placement
+// for Large-Scale Data-Center Applications" https://research.fb.com/wp-content/uploads/2017/01/cgo2017-hfsort-final1.pdf
+
+// clusters are not merged if the density of the merged one is less than 1/8 of the original
+constexpr double gMAX_DENSITY_DEGRADATION = 8.0;
+// a cluster is not larger than 1MB, the benefit of merging decreases as clusters get larger
+constexpr uint64_t gMAX_CLUSTER_SIZE = 1024 * 1024;
+
+struct Edge
+{
+    const Input_section *from;
+    const Input_section *to;
+    uint64_t weight;
+};
+
+struct Cluster
+{
+    Cluster(int sec, uint64_t size) : next(sec), prev(sec), size(size) {}
+
+    double Get_density() const
+    {
+        if (size == 0)
+            return 0;
+        return double(weight) / double(size);
+    }
+
+    // sections of a cluster are in a circular linked list, which starts at the leader of the cluster
+    int next;
+    int prev;
+    uint64_t size;
+    uint64_t weight = 0;
+    uint64_t initial_weight = 0;
+
+    // the caller which calls this section the most times
+    struct
+    {
+        int from = -1;
+        uint64_t weight = 0;
+    } best_pred;
+};
+
+// the section which is in the output for a section where a symbol is defined,
+// nullptr if the section is not in the output or it's not executable
+static const Input_section* Get_output_member(const Linking_context &ctx, const Input_file &file, const Symbol *sym)
+{
+    if (sym == nullptr)
+        return nullptr;
+
+    const Input_file *def_file = nullptr;
+    const Input_section *isec = nLinking_passes::Get_defining_section(ctx, file, *sym, &def_file);
+    if (isec == nullptr)
+        return nullptr;
+
+    if (isec->leader != nullptr)
+        return isec->leader; // folded by --icf
+
+    if (def_file->relocate_state_list()[isec->shndx] != Input_file::eRelocate_state::relocatable)
+        return nullptr;
+
+    if ((isec->shdr().sh_flags & SHF_EXECINSTR) == 0)
+        return nullptr;
+
+    return isec;
+}
+
+// Since LLVM 13, an entry of .llvm.call-graph-profile is a 64-bit weight, and the caller and
+// the callee are the symbols of a pair of R_*_NONE relocations in its relocation section
+static void Read_call_graph_profile(const Linking_context &ctx, const Input_file &file, std::vector<Edge> &edge_list)
+{
+    Relocatable_file &src = file.src();
+    std::size_t n_section = src.section_hdr_table().header_count();
+
+    for(std::size_t i = 0 ; i < n_section ; i++)
+    {
+        if (src.section_hdr(i).sh_type != SHT_LLVM_CALL_GRAPH_PROFILE)
+            continue;
+
+        Input_section profile(src, i);
+
+        for(std::size_t j = 0 ; j < n_section ; j++)
+        {
+            auto &shdr = src.section_hdr(j);
+            if ((shdr.sh_type == SHT_REL || shdr.sh_type == SHT_RELA) && shdr.sh_info == i)
+                profile.Set_relsec_idx(j);
+        }
+
+        std::size_t n_entry = src.section_hdr(i).sh_size / sizeof(uint64_t);
+
+        // the legacy format which refers symbols by indices is not supported
+        if (profile.rel_count() < n_entry * 2)
+            continue;
+
+        auto *weight_list = (const uint64_t*)src.section(i);
+
+        for(std::size_t k = 0 ; k < n_entry ; k++)
+        {
+            const Input_section *from = Get_output_member(ctx, file, file.symbol_list[profile.rela_at(k * 2).sym()]);
+            const Input_section *to = Get_output_member(ctx, file, file.symbol_list[profile.rela_at(k * 2 + 1).sym()]);
+
+            if (from != nullptr && to != nullptr)
+                edge_list.push_back(Edge{from, to, weight_list[k]});
+        }
+    }
+}
+
+// each line of the file is "<caller> <callee> <weight>", symbols are global ones
+static void Read_call_graph_ordering_file(const Linking_context &ctx, std::vector<Edge> &edge_list)
+{
+    const std::string &path = ctx.link_option_args().call_graph_ordering_file;
+
+    std::ifstream fin(path);
+    if (fin.is_open() == false)
+        FATALF("cannot open the call graph ordering file: %s", path.c_str());
+
+    auto get_section = [&](const std::string &name) -> const Input_section*
+    {
+        auto it = ctx.global_symbol_map().find(name);
+        if (it == ctx.global_symbol_map().end() || it->second.input_file == nullptr)
+        {
+            fprintf(stderr, "warning: call graph ordering file: no such symbol: %s\n", name.c_str());
+            return nullptr;
+        }
+
+        return Get_output_member(ctx, *it->second.input_file, it->second.symbol.get());
+    };
+
+    for(std::string line ; std::getline(fin, line) ; )
+    {
+        std::istringstream fields(line);
+        std::string from_name, to_name;
+        uint64_t weight = 0;
+
+        if (!(fields >> from_name))
+            continue;
+
+        if (!(fields >> to_name >> weight))
+            FATALF("malformed line in the call graph ordering file: %s", line.c_str());
+
+        const Input_section *from = get_section(from_name);
+        const Input_section *to = get_section(to_name);
+
+        if (from != nullptr && to != nullptr)
+            edge_list.push_back(Edge{from, to, weight});
+    }
+}
+
+std::unordered_map<const Input_section*, std::size_t> nCall_graph_sort::Compute_section_order(const Linking_context &ctx)
+{
+    const std::vector<Input_file> &input_file_list = ctx.input_file_list();
+
+    // edges of each file are resolved to sections in parallel
+    std::vector<std::vector<Edge>> file_edge_list(input_file_list.size() + 1);
+
+    nUtil::Parallel_for(input_file_list.size(), [&](std::size_t i)
+    {
+        Read_call_graph_profile(ctx, input_file_list[i], file_edge_list[i]);
+    });
+
+    if (ctx.link_option_args().call_graph_ordering_file.empty() == false)
+        Read_call_graph_ordering_file(ctx, file_edge_list.back());
+
+    // Sections are numbered in the order they first appear, and weights of the same
+    // pair of sections are accumulated, so the result doesn't depend on scheduling
+    std::vector<const Input_section*> section_list;
+    std::unordered_map<const Input_section*, int> node_map;
+    std::vector<std::pair<std::pair<int, int>, uint64_t>> profile;
+    std::map<std::pair<int, int>, std::size_t> profile_index;
+
+    auto get_node = [&](const Input_section *isec) -> int
+    {
+        auto [it, is_inserted] = node_map.insert(std::make_pair(isec, (int)section_list.size()));
+        if (is_inserted)
+            section_list.push_back(isec);
+        return it->second;
+    };
+
+    for(auto &edge_list : file_edge_list)
+    {
+        for(const Edge &edge : edge_list)
+        {
+            // edges between sections which are placed in different output sections are useless
+            if (   nLinking_passes::Get_output_section_key(ctx, *edge.from, false).name
+                != nLinking_passes::Get_output_section_key(ctx, *edge.to, false).name)
+                continue;
+
+            std::pair<int, int> key{get_node(edge.from), get_node(edge.to)};
+
+            auto [it, is_inserted] = profile_index.insert(std::make_pair(key, profile.size()));
+            if (is_inserted)
+                profile.emplace_back(key, 0);
+            profile[it->second].second += edge.weight;
+        }
+    }
+
+    std::unordered_map<const Input_section*, std::size_t> order_map;
+
+    if (profile.empty())
+        return order_map;
+
+    std::vector<Cluster> cluster_list;
+    for(std::size_t i = 0 ; i < section_list.size() ; i++)
+        cluster_list.emplace_back(i, section_list[i]->size());
+
+    for(auto &[key, weight] : profile)
+    {
+        auto [from, to] = key;
+
+        cluster_list[to].weight += weight;
+
+        if (from == to)
+            continue;
+
+        // remember the best edge
+        Cluster &to_cluster = cluster_list[to];
+        if (to_cluster.best_pred.from == -1 || to_cluster.best_pred.weight < weight)
+        {
+            to_cluster.best_pred.from = from;
+            to_cluster.best_pred.weight = weight;
+        }
+    }
+
+    for(Cluster &cluster : cluster_list)
+        cluster.initial_weight = cluster.weight;
+
+    // the leader of the cluster which a section belongs to, with path halving
+    std::vector<int> leader_list(cluster_list.size());
+    std::iota(leader_list.begin(), leader_list.end(), 0);
+
+    auto get_leader = [&](int v) -> int
+    {
+        while(leader_list[v] != v)
+        {
+            leader_list[v] = leader_list[leader_list[v]];
+            v = leader_list[v];
+        }
+        return v;
+    };
+
+    auto merge_clusters = [&](Cluster &into, int into_idx, Cluster &from, int from_idx)
+    {
+        int tail1 = into.prev, tail2 = from.prev;
+        into.prev = tail2;
+        cluster_list[tail2].next = into_idx;
+        from.prev = tail1;
+        cluster_list[tail1].next = from_idx;
+        into.size += from.size;
+        into.weight += from.weight;
+        from.size = 0;
+        from.weight = 0;
+    };
+
+    auto by_density = [&](int a, int b)
+    {
+        return cluster_list[a].Get_density() > cluster_list[b].Get_density();
+    };
+
+    std::vector<int> sorted_list(cluster_list.size());
+    std::iota(sorted_list.begin(), sorted_list.end(), 0);
+    std::stable_sort(sorted_list.begin(), sorted_list.end(), by_density);
+
+    // a section is appended to the cluster of its most likely caller, the densest sections go first
+    for(int idx : sorted_list)
+    {
+        Cluster &cluster = cluster_list[idx];
+
+        // don't consider merging if the edge is unlikely
+        if (cluster.best_pred.from == -1 || cluster.best_pred.weight * 10 <= cluster.initial_weight)
+            continue;
+
+        int pred_leader = get_leader(cluster.best_pred.from);
+        if (pred_leader == idx)
+            continue;
+
+        Cluster &pred_cluster = cluster_list[pred_leader];
+        if (cluster.size + pred_cluster.size > gMAX_CLUSTER_SIZE)
+            continue;
+
+        double new_density = double(pred_cluster.weight + cluster.weight) / double(pred_cluster.size + cluster.size);
+        if (new_density < pred_cluster.Get_density() / gMAX_DENSITY_DEGRADATION)
+            continue;
+
+        leader_list[idx] = pred_leader;
+        merge_clusters(pred_cluster, pred_leader, cluster, idx);
+    }
+
+    // sort remaining non-empty clusters by density
+    sorted_list.clear();
+    for(std::size_t i = 0 ; i < cluster_list.size() ; i++)
+    {
+        if (cluster_list[i].size > 0)
+            sorted_list.push_back(i);
+    }
+    std::stable_sort(sorted_list.begin(), sorted_list.end(), by_density);
+
+    std::size_t order = 0;
+    for(int leader : sorted_list)
+    {
+        for(int i = leader ; ; )
+        {
+            order_map[section_list[i]] = order++;
+            i = cluster_list[i].next;
+            if (i == leader)
+                break;
+        }
+    }
+
+    return order_map;
+}
@@ -1,6 +1,7 @@
 // a lot of code is copied or modified from https://github.com/rui314/mold
 
 #include <algorithm>
+#include <array>
 #include <iostream>
 #include "Relocatable_file.h"
 #include "Symbol.h"
@@ -22,7 +23,65 @@ Get_merged_final_dst(Linking_context &ctx,
                      std::size_t entsize, 
                      std::size_t addralign);
 
-static void Sort_relocation(const Input_file &input_file);
+template<typename Rel>
+static void Sort_by_offset(Rel *begin, Rel *end);
+
+// relocation sections shorter than this are sorted by std::stable_sort
+constexpr std::size_t gRADIX_SORT_THRESHOLD = 64;
+
+// Relocations are sorted by r_offset with a stable LSD radix sort. The key is 
+// bounded by the section size, so a pass is skipped if all relocations have 
+// the same digit in it, and usually there are only 2 or 3 passes. Stability is 
+// required, relocations at the same offset (e.g. R_RISCV_CALL and R_RISCV_RELAX,
+// or a SET and SUB pair) have to keep their order.
+template<typename Rel>
+static void Sort_by_offset(Rel *begin, Rel *end)
+{
+    auto cmp = [](const Rel &lhs, const Rel &rhs){return lhs.r_offset < rhs.r_offset;};
+    
+    if (std::is_sorted(begin, end, cmp) == true)
+        return;
+
+    std::size_t n = end - begin;
+
+    if (n < gRADIX_SORT_THRESHOLD)
+    {
+        std::stable_sort(begin, end, cmp);
+        return;
+    }
+
+    uint64_t max_key = std::max_element(begin, end, cmp)->r_offset;
+
+    std::vector<Rel> tmp(n);
+    Rel *src = begin;
+    Rel *dst = tmp.data();
+
+    for(std::size_t shift = 0 ; shift < 64 && (max_key >> shift) != 0 ; shift += 8)
+    {
+        std::array<std::size_t, 256> pos{};
+
+        for(std::size_t i = 0 ; i < n ; i++)
+            pos[(src[i].r_offset >> shift) & 0xff]++;
+        
+        if (pos[(src[0].r_offset >> shift) & 0xff] == n)
+            continue;
+        
+        for(std::size_t i = 0, sum = 0 ; i < pos.size() ; i++)
+        {
+            std::size_t cnt = pos[i];
+            pos[i] = sum;
+            sum += cnt;
+        }
+
+        for(std::size_t i = 0 ; i < n ; i++)
+            dst[pos[(src[i].r_offset >> shift) & 0xff]++] = src[i];
+
+        std::swap(src, dst);
+    }
+
+    if (src != begin)
+        std::copy(src, src + n, begin);
+}
 
 static void Init_local_symbols(std::unique_ptr<Symbol[]> &dst, const Relocatable_file &rel_file, std::size_t n_local_sym)
 {
@@ -41,35 +100,6 @@ static void Init_local_symbols(std::unique_ptr<Symbol[]> &dst, const Relocatable
     }
 }
 
-static void Sort_relocation(const Input_file &input_file)
-{
-    for(std::size_t i = 0 ; i < input_file.src().section_hdr_table().header_count() ; i++)
-    {
-        auto &shdr = input_file.src().section_hdr(i);
-
-        if (shdr.sh_type == SHT_REL)
-        {
-            Elf64_Rel *rel = reinterpret_cast<Elf64_Rel*>(input_file.src().section(i));
-            auto end = rel + shdr.sh_size / shdr.sh_entsize;
-            auto cmp = [](const Elf64_Rel &lhs, const Elf64_Rel &rhs){return lhs.r_offset < rhs.r_offset;};
-            if (std::is_sorted(rel, end, cmp) == false)
-                std::sort(rel, end, cmp);
-        }
-        else if (shdr.sh_type == SHT_RELA)
-        {
-            Elf64_Rela *rela = reinterpret_cast<Elf64_Rela*>(input_file.src().section(i));
-            auto end = rela + shdr.sh_size / shdr.sh_entsize;
-            auto cmp = [](const Elf64_Rela &lhs, const Elf64_Rela &rhs){return lhs.r_offset < rhs.r_offset;};
-            if (std::is_sorted(rela, end, cmp) == false)
-                std::sort(rela, end, cmp);
-        }
-        else
-            continue;
-    }
-}
-
-
-
 Input_file::Input_file(Relocatable_file &src) : m_src(&src)
 {    
     m_relocate_state_list.resize(m_src->section_hdr_table().header_count());
@@ -82,6 +112,7 @@ Input_file::Input_file(Relocatable_file &src) : m_src(&src)
         switch (shdr.sh_type)
         {
             case SHT_GROUP:
+            case SHT_LLVM_CALL_GRAPH_PROFILE: // read by nCall_graph_sort
             case SHT_RISC_V_ATTRIBUTES:
             case SHT_REL:
             case SHT_RELA:
@@ -148,12 +179,28 @@ Input_file::Input_file(Relocatable_file &src) : m_src(&src)
         if (auto *ptr = Get_input_section(shdr.sh_info) ; ptr != nullptr)
             ptr->Set_relsec_idx(i);
     }
-
-    Sort_relocation(*this);
 }
 
 Input_file::~Input_file() = default;
 
+void Input_file::Sort_relocation(std::size_t relsec_idx) const
+{
+    auto &shdr = src().section_hdr(relsec_idx);
+
+    if (shdr.sh_type == SHT_REL)
+    {
+        Elf64_Rel *rel = reinterpret_cast<Elf64_Rel*>(src().section(relsec_idx));
+        Sort_by_offset(rel, rel + shdr.sh_size / shdr.sh_entsize);
+    }
+    else if (shdr.sh_type == SHT_RELA)
+    {
+        Elf64_Rela *rela = reinterpret_cast<Elf64_Rela*>(src().section(relsec_idx));
+        Sort_by_offset(rela, rela + shdr.sh_size / shdr.sh_entsize);
+    }
+    else
+        FATALF("section %lu is not a relocation section", relsec_idx);
+}
+
 
 
 //put defined global symbols into the gloable symbal map
@@ -473,7 +520,12 @@ void Input_file::Compute_symtab_size(Linking_context &ctx)
         if (Merged_section::Piece *piece = sym->piece())
             return piece->is_alive;
 
-        return Get_symbol_input_section(*sym) != nullptr;
+        Input_section *isec = Get_symbol_input_section(*sym);
+
+        if (isec == nullptr)
+            return false;
+
+        return m_relocate_state_list[isec->shndx] != eRelocate_state::no_need || isec->leader != nullptr;
     };
 
     for (std::size_t i = 1; i < this->n_local_sym(); i++)
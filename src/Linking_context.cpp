@@ -14,6 +14,9 @@ using Link_option_args = Linking_context::Link_option_args;
 
 constexpr std::size_t gARCHIVE_MAGIC_LEN = nUtil::const_expr_STR_len(ARCHIVE_FILE_MAGIC);
 
+// the maximum number of linker relaxation passes
+constexpr std::size_t gMAX_RELAX_PASS = 16;
+
 enum class eFile_type :decltype(elf64_hdr::e_type)
 {
     ET_NONE   = 0,
@@ -264,6 +267,179 @@ static void Parse_args(Link_option_args *dst, int argc, char* argv[])
 
             printf("m option %s\n", &argv[i][2]);
         }
+        else if (strcmp(argv[i], "--relax") == 0)
+        {
+            link_option_args.relax = true;
+        }
+        else if (strcmp(argv[i], "--no-relax") == 0)
+        {
+            link_option_args.relax = false;
+        }
+        else if (strcmp(argv[i], "--relax-tbljal") == 0)
+        {
+            link_option_args.relax_tbljal = true;
+        }
+        else if (strncmp(argv[i], "--relax-tbljal-threshold=", strlen("--relax-tbljal-threshold=")) == 0)
+        {
+            link_option_args.relax_tbljal_threshold = strtoll(argv[i] + strlen("--relax-tbljal-threshold="), nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--print-table-jump") == 0)
+        {
+            link_option_args.print_table_jump = true;
+        }
+        else if (strcmp(argv[i], "--gc-sections") == 0)
+        {
+            link_option_args.gc_sections = true;
+        }
+        else if (strcmp(argv[i], "--no-gc-sections") == 0)
+        {
+            link_option_args.gc_sections = false;
+        }
+        else if (strcmp(argv[i], "--print-gc-sections") == 0)
+        {
+            link_option_args.print_gc_sections = true;
+        }
+        else if (strncmp(argv[i], "--icf=", strlen("--icf=")) == 0)
+        {
+            std::string_view mode = argv[i] + strlen("--icf=");
+
+            if (mode == "none")
+                link_option_args.icf = Linking_context::Link_option_args::eIcf_mode::none;
+            else if (mode == "safe")
+                link_option_args.icf = Linking_context::Link_option_args::eIcf_mode::safe;
+            else if (mode == "all")
+                link_option_args.icf = Linking_context::Link_option_args::eIcf_mode::all;
+            else
+                FATALF("unknown --icf mode: %s", argv[i]);
+        }
+        else if (strcmp(argv[i], "--print-icf-sections") == 0)
+        {
+            link_option_args.print_icf_sections = true;
+        }
+        else if (strcmp(argv[i], "--symbol-ordering-file") == 0)
+        {
+            if (i + 1 == argc)
+                FATALF("%s", "a file name is not specified after --symbol-ordering-file");
+            link_option_args.symbol_ordering_file = argv[++i];
+        }
+        else if (strncmp(argv[i], "--symbol-ordering-file=", strlen("--symbol-ordering-file=")) == 0)
+        {
+            link_option_args.symbol_ordering_file = argv[i] + strlen("--symbol-ordering-file=");
+        }
+        else if (strcmp(argv[i], "--call-graph-profile-sort") == 0)
+        {
+            link_option_args.call_graph_profile_sort = true;
+        }
+        else if (strcmp(argv[i], "--no-call-graph-profile-sort") == 0)
+        {
+            link_option_args.call_graph_profile_sort = false;
+        }
+        else if (strcmp(argv[i], "--call-graph-ordering-file") == 0)
+        {
+            if (i + 1 == argc)
+                FATALF("%s", "a file name is not specified after --call-graph-ordering-file");
+            link_option_args.call_graph_ordering_file = argv[++i];
+        }
+        else if (strncmp(argv[i], "--call-graph-ordering-file=", strlen("--call-graph-ordering-file=")) == 0)
+        {
+            link_option_args.call_graph_ordering_file = argv[i] + strlen("--call-graph-ordering-file=");
+        }
+        else if (strcmp(argv[i], "--data-access-profile") == 0)
+        {
+            if (i + 1 == argc)
+                FATALF("%s", "a file name is not specified after --data-access-profile");
+            link_option_args.data_access_profile = argv[++i];
+        }
+        else if (strncmp(argv[i], "--data-access-profile=", strlen("--data-access-profile=")) == 0)
+        {
+            link_option_args.data_access_profile = argv[i] + strlen("--data-access-profile=");
+        }
+        else if (strncmp(argv[i], "--cache-line-isolate=", strlen("--cache-line-isolate=")) == 0)
+        {
+            link_option_args.cache_line_isolate.push_back(argv[i] + strlen("--cache-line-isolate="));
+        }
+        else if (strncmp(argv[i], "--cache-line-size=", strlen("--cache-line-size=")) == 0)
+        {
+            link_option_args.cache_line_size = strtoull(argv[i] + strlen("--cache-line-size="), nullptr, 10);
+            if (nUtil::has_single_bit(link_option_args.cache_line_size) == false)
+                FATALF("the cache line size should be a power of 2: %s", argv[i]);
+        }
+        else if (strncmp(argv[i], "--sort-section=", strlen("--sort-section=")) == 0)
+        {
+            std::string_view mode = argv[i] + strlen("--sort-section=");
+
+            if (mode == "alignment")
+                link_option_args.sort_section_alignment = true;
+            else if (mode == "none")
+                link_option_args.sort_section_alignment = false;
+            else
+                FATALF("unknown --sort-section mode: %s", argv[i]);
+        }
+        else if (strcmp(argv[i], "--print-section-packing") == 0)
+        {
+            link_option_args.print_section_packing = true;
+        }
+        else if (strncmp(argv[i], "--function-alignment=", strlen("--function-alignment=")) == 0)
+        {
+            link_option_args.function_alignment = strtoull(argv[i] + strlen("--function-alignment="), nullptr, 10);
+            if (nUtil::has_single_bit(link_option_args.function_alignment) == false)
+                FATALF("the function alignment should be a power of 2: %s", argv[i]);
+        }
+        else if (strcmp(argv[i], "--function-alignment-file") == 0)
+        {
+            if (i + 1 == argc)
+                FATALF("%s", "a file name is not specified after --function-alignment-file");
+            link_option_args.function_alignment_file = argv[++i];
+        }
+        else if (strncmp(argv[i], "--function-alignment-file=", strlen("--function-alignment-file=")) == 0)
+        {
+            link_option_args.function_alignment_file = argv[i] + strlen("--function-alignment-file=");
+        }
+        else if (strcmp(argv[i], "--print-function-alignment") == 0)
+        {
+            link_option_args.print_function_alignment = true;
+        }
+        else if (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--nmagic") == 0)
+        {
+            link_option_args.segment_packing = Linking_context::Link_option_args::eSegment_packing::nmagic;
+        }
+        else if (strcmp(argv[i], "-N") == 0 || strcmp(argv[i], "--omagic") == 0)
+        {
+            link_option_args.segment_packing = Linking_context::Link_option_args::eSegment_packing::omagic;
+        }
+        else if (strcmp(argv[i], "--no-omagic") == 0)
+        {
+            link_option_args.segment_packing = Linking_context::Link_option_args::eSegment_packing::page;
+        }
+        else if (strcmp(argv[i], "--zero-data-to-bss") == 0)
+        {
+            link_option_args.zero_data_to_bss = true;
+        }
+        else if (strcmp(argv[i], "--no-zero-data-to-bss") == 0)
+        {
+            link_option_args.zero_data_to_bss = false;
+        }
+        else if (memcmp(argv[i], "-z", 2) == 0) // "-z <option>" or "-z<option>"
+        {
+            if (argv[i][2] == '\0' && i + 1 == argc)
+                FATALF("%s", "an option is not specified after -z");
+
+            std::string_view option = argv[i][2] == '\0' ? argv[++i] : argv[i] + 2;
+
+            if (option == "keep-text-section-prefix")
+                link_option_args.keep_text_section_prefix = true;
+            else if (option == "nokeep-text-section-prefix")
+                link_option_args.keep_text_section_prefix = false;
+            else if (option == "hugepage-align")
+                link_option_args.hugepage_align = true;
+            else if (option == "nohugepage-align")
+                link_option_args.hugepage_align = false;
+            else if (option == "separate-code")
+                link_option_args.separate_code = true;
+            else if (option == "noseparate-code")
+                link_option_args.separate_code = false;
+            // the other -z options are ignored
+        }
         else if (memcmp(argv[i], "-L", 2) == 0 && argv[i][2] != '\0') // it should not be just "-L")
         {
             link_option_args.library_search_path.push_back(argv[i]);
@@ -287,6 +463,10 @@ static void Parse_args(Link_option_args *dst, int argc, char* argv[])
 
     if (output_file != nullptr)
         link_option_args.output_file = output_file;
+
+    // the file only chooses the functions, the alignment is given by --function-alignment
+    if (link_option_args.function_alignment_file.empty() == false && link_option_args.function_alignment == 0)
+        FATALF("%s", "--function-alignment-file is specified without --function-alignment");
 }
 
 
@@ -397,6 +577,7 @@ static void Add_synthetic_symbols(Linking_context &ctx)
     };
     add_esym(""); // put the first symbol, which is a dummy symbol
     add_esym(ctx.special_symbols.global_pointer_name);
+    add_esym(ctx.special_symbols.jvt_base_name);
     add_esym(ctx.special_symbols.bss_start_name);
     add_esym(ctx.special_symbols.end_name);
     add_esym(ctx.special_symbols._end_name);
@@ -455,6 +636,8 @@ void Linking_context::Link()
     }
     assert(m_input_file.size() == m_rel_file.size());
 
+    nLinking_passes::Resolve_comdat_groups(*this, m_input_file, m_is_alive);
+
     for(auto &file : m_input_file)
         file.Put_global_symbol(*this);
 
@@ -464,6 +647,14 @@ void Linking_context::Link()
 
     Clear_unused_resources(*this, m_global_symbol_map, m_rel_file, m_input_file, m_is_alive);
 
+    nLinking_passes::Resolve_comdat_groups(*this, m_input_file, std::vector<bool>(m_input_file.size(), true));
+
+    // it's defined by a library member in general, so it's bound after the unused members are removed
+    if (auto it = Find_symbol(special_symbols.tls_get_addr_name) ; it != m_global_symbol_map.end())
+        special_symbols.tls_get_addr = it->second.symbol.get();
+
+    nLinking_passes::Sort_relocations(*this);
+
     for(std::size_t i = 0 ; i < m_input_file.size() ; i++)
         m_input_file[i].Init_mergeable_section(*this);
 
@@ -472,6 +663,12 @@ void Linking_context::Link()
 
     for(std::size_t i = 0 ; i < m_input_file.size() ; i++)
         m_input_file[i].Resolve_sesction_pieces(*this);
+
+    if (m_link_option_args.gc_sections)
+        nLinking_passes::Gc_sections(*this, m_input_file);
+
+    if (m_link_option_args.icf != Link_option_args::eIcf_mode::none)
+        nLinking_passes::Fold_identical_sections(*this, m_input_file);
     
     for(auto &item : merged_section_map())
     {
@@ -480,11 +677,20 @@ void Linking_context::Link()
 
     nLinking_passes::Create_synthetic_sections(*this);
 
+    nLinking_passes::Create_got(*this);
+
+    nLinking_passes::Create_jvt(*this);
+
      for(std::size_t i = 0 ; i < m_input_file.size() ; i++)
         nLinking_passes::Check_duplicate_smbols(m_input_file[i]);
 
     nLinking_passes::Combined_input_sections(*this);
 
+    nLinking_passes::Sort_output_section_members(*this);
+
+    if (m_link_option_args.function_alignment != 0)
+        nLinking_passes::Align_functions(*this);
+
     nLinking_passes::Assign_input_section_offset(*this);
 
     nLinking_passes::Sort_output_sections(*this);
@@ -496,6 +702,33 @@ void Linking_context::Link()
     filesize = nLinking_passes::Set_output_chunk_locations(*this);
 
     nLinking_passes::Fix_up_synthetic_symbols(*this);
+
+    // Linker relaxation shrinks code and range extension thunks are inserted for jumps which are out of range, 
+    // so the layout is recomputed after each pass. Relaxed code rarely grows back and thunks are never removed, 
+    // so passes converge, but the number of passes is still bounded.
+    bool is_converged = false;
+    for(std::size_t pass = 0 ; pass < gMAX_RELAX_PASS ; pass++)
+    {
+        bool is_changed = nLinking_passes::Relax_sections(*this);
+        is_changed = nLinking_passes::Create_thunks(*this) || is_changed;
+
+        if (is_changed == false)
+        {
+            is_converged = true;
+            break;
+        }
+
+        nLinking_passes::Assign_input_section_offset(*this);
+        filesize = nLinking_passes::Set_output_chunk_locations(*this);
+        nLinking_passes::Fix_up_synthetic_symbols(*this);
+    }
+
+    // the code is relocated on the last layout, which the relaxation doesn't fit yet
+    if (is_converged == false)
+        FATALF("relaxation doesn't converge in %lu passes", gMAX_RELAX_PASS);
+
+    if (m_link_option_args.print_function_alignment)
+        nLinking_passes::Print_function_alignment(*this);
     
     using perm_t = std::filesystem::perms;
     
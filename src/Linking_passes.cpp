@@ -1,35 +1,45 @@
 #include <iostream>
 #include <unordered_map>
+#include <unordered_set>
 #include <numeric>
 #include <atomic>
 #include <algorithm>
 #include <queue>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <tuple>
 
 #include "Linking_passes.h"
 #include "Linking_context_helper.h"
 #include "ELF_util.h"
 #include "Chunk/Output_section.h"
+#include "Relocation.h"
+#include "third_party/Spin_lock.h"
+#include "Call_graph_sort.h"
 
 using nLinking_context_helper::to_phdr_flags;
-using nUtil::bit;
-using nUtil::EPOI;
 // a lot of code is copied from https://github.com/rui314/mold
 
 static void Set_virtual_addresses(Linking_context &ctx);
 static std::size_t Set_file_offsets(Linking_context &ctx);
 static bool Is_tbss(const Chunk *chunk);
 static uint64_t Align_with_skew(uint64_t val, uint64_t align, uint64_t skew);
-static void write_itype(uint8_t *loc, uint32_t val);
-static void write_stype(uint8_t *loc, uint32_t val);
-static void write_btype(uint8_t *loc, uint32_t val);
-static void write_utype(uint8_t *loc, uint32_t val);
-static void write_jtype(uint8_t *loc, uint32_t val);
-static void write_citype(uint8_t *loc, uint32_t val);
-static void write_cbtype(uint8_t *loc, uint32_t val);
-static void write_cjtype(uint8_t *loc, uint32_t val);
-static void set_rs1(uint8_t *loc, uint32_t rs1);
-static void Reloc_alloc(Linking_context &ctx, Output_section &osec, std::size_t isec_idx);
-static void Reloc_non_alloc(Linking_context &ctx, Output_section &osec, std::size_t isec_idx);
+static bool Is_gc_root(const Input_section &isec);
+static bool Is_c_identifier(std::string_view name);
+static bool Is_icf_eligible(const Input_file &file, const Input_section &isec, bool fold_rodata);
+static uint64_t Hash_combine(uint64_t seed, uint64_t val);
+static std::vector<std::string> Read_name_list(const std::string &path, const char *what);
+static std::vector<std::pair<const Input_section*, std::size_t>> 
+Scan_defining_sections(const Linking_context &ctx, const std::function<std::size_t(const Symbol&)> &get_index);
+static std::vector<std::pair<const Input_section*, std::size_t>> 
+Find_defining_sections(const Linking_context &ctx, const std::vector<std::string> &name_list, const char *what,
+                       const std::function<bool(const Symbol&)> &is_wanted = nullptr);
+static std::unordered_map<const Input_section*, std::size_t> Get_symbol_ordering_priority(const Linking_context &ctx);
+static std::unordered_map<const Input_section*, uint64_t> Get_data_access_count(const Linking_context &ctx);
+static std::size_t Get_text_prefix_rank(std::string_view name);
+static bool Is_packable_section(const Output_section &osec);
+static std::size_t Get_padding_size(const std::vector<Output_section::Member> &member_list);
 
 void nLinking_passes::Check_duplicate_smbols(const Input_file &file)
 {
@@ -62,6 +72,29 @@ void nLinking_passes::Check_duplicate_smbols(const Input_file &file)
     }
 }
 
+void nLinking_passes::Sort_relocations(Linking_context &ctx)
+{
+    // one job per relocation section, so that a large file is spread over threads as well
+    std::vector<std::pair<const Input_file*, std::size_t>> job_list;
+
+    for(const Input_file &input_file : ctx.input_file_list())
+    {
+        for(const Input_section &isec : input_file.input_section_list)
+        {
+            if (   isec.relsec_idx() == (std::size_t)-1 
+                || input_file.relocate_state_list()[isec.shndx] == Input_file::eRelocate_state::no_need)
+                continue;
+
+            job_list.push_back({&input_file, isec.relsec_idx()});
+        }
+    }
+
+    nUtil::Parallel_for(job_list.size(), [&](std::size_t i)
+    {
+        job_list[i].first->Sort_relocation(job_list[i].second);
+    });
+}
+
 // Bind undef global symbols in symbol list of a input file to defined global symbols.
 // If a file is not referenced by other files through global symbols, then
 // content of this file is no need to be linked into the output file.
@@ -83,8 +116,13 @@ void nLinking_passes::Reference_dependent_file(Input_file &input_file,
         // it's defined, don't mark alive its source, because it's itself
         bool undef = nELF_util::Is_sym_undef(esym) == true;
         bool common = nELF_util::Is_sym_common(esym) == true && nELF_util::Is_sym_common(input_file.symbol_list[sym_idx]->elf_sym()) == false;
+        // it's defined in a COMDAT group which is owned by the other file, so it's bound to the definition there
+        bool discarded =    undef == false 
+                         && nELF_util::Is_sym_abs(esym) == false 
+                         && nELF_util::Is_sym_common(esym) == false
+                         && input_file.relocate_state_list()[input_file.src().get_shndx(esym)] == Input_file::eRelocate_state::no_need;
         
-        if (undef == false && common == false)
+        if (undef == false && common == false && discarded == false)
             continue;
         
         auto it = ctx.Find_symbol(nELF_util::Get_symbol_name(input_file.src(), sym_idx));
@@ -105,6 +143,161 @@ void nLinking_passes::Reference_dependent_file(Input_file &input_file,
     }
 }
 
+void nLinking_passes::Resolve_comdat_groups(Linking_context &ctx, std::vector<Input_file> &input_file_list, const std::vector<bool> &is_alive)
+{
+    // signatures are sharded by their hashes, so that files put their groups at the same time
+    constexpr std::size_t n_shard = 64;
+
+    struct Shard
+    {
+        Spin_lock lock;
+        // the signature of a group and the index of the first live file which has it
+        std::unordered_map<std::string_view, std::size_t> owner_map;
+    };
+
+    std::vector<Shard> shard_list(n_shard);
+
+    auto get_shard = [&](std::string_view signature) -> Shard&
+    {
+        return shard_list[std::hash<std::string_view>{}(signature) % n_shard];
+    };
+
+    // call f(shndx, signature) for each COMDAT group of a file which is not discarded yet
+    auto for_each_group = [](const Input_file &file, auto &&f)
+    {
+        for(std::size_t i = 0 ; i < file.src().section_hdr_table().header_count() ; i++)
+        {
+            auto &shdr = file.src().section_hdr(i);
+
+            if (shdr.sh_type != SHT_GROUP || shdr.sh_size < sizeof(uint32_t) * 2)
+                continue;
+
+            // the first word is the flags, and the members follow
+            auto *word = (const uint32_t*)file.src().section(i);
+            if (   (word[0] & GRP_COMDAT) == 0
+                || file.relocate_state_list()[word[1]] == Input_file::eRelocate_state::no_need)
+                continue;
+
+            f(i, nELF_util::Get_symbol_name(file.src(), shdr.sh_info));
+        }
+    };
+
+    nUtil::Parallel_for(input_file_list.size(), [&](std::size_t i)
+    {
+        if (is_alive[i] == false)
+            return;
+
+        for_each_group(input_file_list[i], [&](std::size_t, std::string_view signature)
+        {
+            Shard &shard = get_shard(signature);
+
+            shard.lock.lock();
+            auto [it, is_inserted] = shard.owner_map.insert(std::make_pair(signature, i));
+            if (is_inserted == false)
+                it->second = std::min(it->second, i); // the result doesn't depend on the order of insertion
+            shard.lock.unlock();
+        });
+    });
+
+    // global symbols defined in the groups of each file, they are bound to the definitions of the owners
+    std::vector<std::vector<std::size_t>> group_symbol_list(input_file_list.size());
+
+    nUtil::Parallel_for(input_file_list.size(), [&](std::size_t i)
+    {
+        Input_file &file = input_file_list[i];
+        // members of the groups which the file owns or loses
+        std::vector<std::size_t> member_list;
+
+        for_each_group(file, [&](std::size_t shndx, std::string_view signature)
+        {
+            auto &owner_map = get_shard(signature).owner_map;
+            auto it = owner_map.find(signature);
+
+            // no live file has it yet, it's resolved again after the library members are extracted
+            if (it == owner_map.end())
+                return;
+
+            auto *word = (uint32_t*)file.src().section(shndx);
+            std::size_t n_word = file.src().section_hdr(shndx).sh_size / sizeof(uint32_t);
+
+            for(std::size_t j = 1 ; j < n_word ; j++)
+            {
+                if (it->second != i)
+                    file.Discard_section(word[j]);
+                member_list.push_back(word[j]);
+            }
+        });
+
+        if (member_list.empty())
+            return;
+
+        std::sort(member_list.begin(), member_list.end());
+
+        for(std::size_t sym_idx = file.src().linking_mdata().first_global ; sym_idx < file.src().symbol_table()->count() ; sym_idx++)
+        {
+            auto &esym = file.src().symbol_table()->data(sym_idx);
+
+            if (nELF_util::Is_sym_undef(esym) || nELF_util::Is_sym_abs(esym) || nELF_util::Is_sym_common(esym))
+                continue;
+
+            // a definition of an owner is bound again as well, the owner might not be the first file 
+            // which defines it, which is what the global symbol table picked
+            if (std::binary_search(member_list.begin(), member_list.end(), file.src().get_shndx(esym)))
+                group_symbol_list[i].push_back(sym_idx);
+        }
+    });
+
+    // Definitions of the owners are put first, then the discarded ones are bound to them. Before
+    // global symbols are put, this just puts the owners' definitions ahead of the others
+    auto bind_group_symbols = [&](bool is_owner_pass)
+    {
+        for(std::size_t i = 0 ; i < input_file_list.size() ; i++)
+        {
+            Input_file &file = input_file_list[i];
+
+            for(std::size_t sym_idx : group_symbol_list[i])
+            {
+                auto &esym = file.src().symbol_table()->data(sym_idx);
+                bool is_discarded = file.relocate_state_list()[file.src().get_shndx(esym)] == Input_file::eRelocate_state::no_need;
+
+                if (is_discarded == is_owner_pass)
+                    continue;
+
+                if (is_owner_pass)
+                {
+                    auto &link_pkg = ctx.Insert_global_symbol(file, sym_idx);
+                    Input_file &definer = *link_pkg.input_file;
+                    auto &def_esym = link_pkg.symbol->elf_sym();
+                    bool is_def_discarded =    nELF_util::Is_sym_abs(def_esym) == false
+                                            && definer.relocate_state_list()[definer.src().get_shndx(def_esym)] == Input_file::eRelocate_state::no_need;
+
+                    // the definition in a discarded group is replaced in place, so the files 
+                    // which are already bound to it see the owner's definition
+                    if (&definer != &file && is_def_discarded)
+                    {
+                        *link_pkg.symbol = Symbol(file.src(), sym_idx);
+                        link_pkg.input_file = &file;
+                    }
+                    file.symbol_list[sym_idx] = link_pkg.symbol.get();
+                }
+                else if (file.symbol_list[sym_idx] != nullptr)
+                {
+                    // not bound yet before global symbols are put, Reference_dependent_file binds it
+                    auto it = ctx.Find_symbol(nELF_util::Get_symbol_name(file.src(), sym_idx));
+
+                    if (it == ctx.global_symbol_map().end())
+                        FATALF("%s", "undefined symbol");
+
+                    file.symbol_list[sym_idx] = it->second.Mark_ref();
+                }
+            }
+        }
+    };
+
+    bind_group_symbols(true);
+    bind_group_symbols(false);
+}
+
 void nLinking_passes::Resolve_symbols(Linking_context &ctx, std::vector<Input_file> &input_file_list, std::vector<bool> &is_alive)
 {    
     std::queue<std::size_t> file_idx_queue;
@@ -136,6 +329,402 @@ void nLinking_passes::Resolve_symbols(Linking_context &ctx, std::vector<Input_fi
     }
 }
 
+void nLinking_passes::Gc_sections(Linking_context &ctx, std::vector<Input_file> &input_file_list)
+{
+    using eRelocate_state = Input_file::eRelocate_state;
+
+    struct Item
+    {
+        std::size_t file_idx;
+        const Input_section *isec;
+    };
+
+    // a flag for each input section, indexed in the same way as Input_file::input_section_list
+    std::vector<std::unique_ptr<std::atomic<bool>[]>> visited_list(input_file_list.size());
+    for(std::size_t i = 0 ; i < input_file_list.size() ; i++)
+        visited_list[i] = std::make_unique<std::atomic<bool>[]>(input_file_list[i].input_section_list.size());
+
+    // pieces of allocated mergeable sections are kept only if they are referred
+    for(auto &item : ctx.merged_section_map())
+    {
+        if ((item.second->shdr.sh_flags & SHF_ALLOC) == 0)
+            continue;
+
+        for(auto &piece : item.second->piece_map())
+            piece.second->is_alive = false;
+    }
+
+    // true if it's the first time that the section is visited
+    auto visit = [&](std::size_t file_idx, const Input_section &isec) -> bool
+    {
+        std::size_t idx = &isec - input_file_list[file_idx].input_section_list.data();
+        return visited_list[file_idx][idx].exchange(true) == false;
+    };
+
+    // mark the section or the piece where 'sym' is defined, 'file' is the file which refers 'sym'
+    auto visit_symbol = [&](const Input_file &file, const Symbol *sym, std::vector<Item> &next)
+    {
+        if (sym == nullptr)
+            return;
+
+        if (Merged_section::Piece *piece = sym->piece())
+        {
+            piece->is_alive = true;
+            return;
+        }
+
+        const Input_file *def_file = nullptr;
+        const Input_section *isec = Get_defining_section(ctx, file, *sym, &def_file);
+        if (isec == nullptr || def_file->relocate_state_list()[isec->shndx] != eRelocate_state::relocatable)
+            return;
+
+        std::size_t file_idx = def_file - input_file_list.data();
+        if (visit(file_idx, *isec))
+            next.push_back(Item{file_idx, isec});
+    };
+
+    std::vector<Item> frontier;
+
+    for(std::size_t i = 0 ; i < input_file_list.size() ; i++)
+    {
+        for(const Input_section &isec : input_file_list[i].input_section_list)
+        {
+            if (input_file_list[i].relocate_state_list()[isec.shndx] != eRelocate_state::relocatable)
+                continue;
+
+            // non-alloc sections are kept, but they don't keep the sections they refer alive
+            if ((isec.shdr().sh_flags & SHF_ALLOC) == 0)
+                visit(i, isec);
+            else if (Is_gc_root(isec) && visit(i, isec))
+                frontier.push_back(Item{i, &isec});
+        }
+    }
+
+    for(const Symbol *sym : {ctx.special_symbols.entry, ctx.special_symbols.init, ctx.special_symbols.fiini})
+    {
+        if (sym != nullptr && input_file_list.empty() == false)
+            visit_symbol(input_file_list.front(), sym, frontier);
+    }
+
+    // Sections are marked level by level, sections of a level are scanned in parallel, 
+    // and the atomic flags make sure that every section is put in the next level only once.
+    while(frontier.empty() == false)
+    {
+        std::vector<std::vector<Item>> next_list(frontier.size());
+
+        nUtil::Parallel_for(frontier.size(), [&](std::size_t i)
+        {
+            const Input_file &file = input_file_list[frontier[i].file_idx];
+            const Input_section &isec = *frontier[i].isec;
+
+            for(std::size_t rel_idx = 0 ; rel_idx < isec.rel_count() ; rel_idx++)
+                visit_symbol(file, file.symbol_list[isec.rela_at(rel_idx).sym()], next_list[i]);
+        });
+
+        frontier.clear();
+        for(auto &next : next_list)
+            frontier.insert(frontier.end(), next.begin(), next.end());
+    }
+
+    for(std::size_t i = 0 ; i < input_file_list.size() ; i++)
+    {
+        Input_file &file = input_file_list[i];
+
+        for(std::size_t j = 0 ; j < file.input_section_list.size() ; j++)
+        {
+            const Input_section &isec = file.input_section_list[j];
+
+            if (   visited_list[i][j] == true
+                || file.relocate_state_list()[isec.shndx] != eRelocate_state::relocatable)
+                continue;
+
+            if (ctx.link_option_args().print_gc_sections)
+                printf("removing unused section %.*s:(%.*s)\n", (int)file.name().size(), file.name().data(), 
+                                                                (int)isec.name().size(), isec.name().data());
+
+            file.Discard_section(isec.shndx);
+        }
+    }
+}
+
+void nLinking_passes::Fold_identical_sections(Linking_context &ctx, std::vector<Input_file> &input_file_list)
+{
+    using T = eReloc_type;
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    // distinct constant objects may be compared by their addresses like functions, and every 
+    // reference to data takes its address, so read-only data is folded only by --icf=all
+    bool fold_rodata = ctx.link_option_args().icf == Link_option_args::eIcf_mode::all;
+
+    // With --icf=safe, a section is not folded if its address is taken by anything other than 
+    // a jump, because programs may compare function pointers
+    std::vector<std::unique_ptr<std::atomic<bool>[]>> address_taken_list(input_file_list.size());
+    for(std::size_t i = 0 ; i < input_file_list.size() ; i++)
+        address_taken_list[i] = std::make_unique<std::atomic<bool>[]>(input_file_list[i].input_section_list.size());
+
+    if (ctx.link_option_args().icf == Link_option_args::eIcf_mode::safe)
+    {
+        nUtil::Parallel_for(input_file_list.size(), [&](std::size_t i)
+        {
+            const Input_file &file = input_file_list[i];
+
+            for(const Input_section &isec : file.input_section_list)
+            {
+                if (   (isec.shdr().sh_flags & SHF_ALLOC) == 0
+                    || file.relocate_state_list()[isec.shndx] != Input_file::eRelocate_state::relocatable)
+                    continue;
+
+                for(std::size_t rel_idx = 0 ; rel_idx < isec.rel_count() ; rel_idx++)
+                {
+                    nELF_util::ELF_Rel rel = isec.rela_at(rel_idx);
+
+                    switch (rel.type())
+                    {
+                        case (std::size_t)T::R_RISCV_BRANCH:     case (std::size_t)T::R_RISCV_JAL:
+                        case (std::size_t)T::R_RISCV_CALL:       case (std::size_t)T::R_RISCV_CALL_PLT:
+                        case (std::size_t)T::R_RISCV_RVC_BRANCH: case (std::size_t)T::R_RISCV_RVC_JUMP:
+                        case (std::size_t)T::R_RISCV_RELAX:      case (std::size_t)T::R_RISCV_ALIGN:
+                        // they refer the label of the paired HI20 relocation 
+                        case (std::size_t)T::R_RISCV_PCREL_LO12_I: case (std::size_t)T::R_RISCV_PCREL_LO12_S:
+                            continue;
+                        default:
+                            break;
+                    }
+
+                    const Symbol *sym = file.symbol_list[rel.sym()];
+                    if (sym == nullptr)
+                        continue;
+
+                    const Input_file *def_file = nullptr;
+                    if (const Input_section *target = Get_defining_section(ctx, file, *sym, &def_file) ; target != nullptr)
+                        address_taken_list[def_file - input_file_list.data()][target - def_file->input_section_list.data()] = true;
+                }
+            }
+        });
+    }
+
+    struct Eligible
+    {
+        std::size_t file_idx;
+        Input_section *isec;
+    };
+
+    // eligible sections in the order of files, a section with a smaller index is preferred to be the leader
+    std::vector<Eligible> isec_list;
+    // the index in 'isec_list' of each input section or -1, indexed in the same way as Input_file::input_section_list
+    std::vector<std::vector<int32_t>> eligible_idx_list(input_file_list.size());
+
+    for(std::size_t i = 0 ; i < input_file_list.size() ; i++)
+    {
+        Input_file &file = input_file_list[i];
+        eligible_idx_list[i].resize(file.input_section_list.size(), -1);
+
+        for(std::size_t j = 0 ; j < file.input_section_list.size() ; j++)
+        {
+            if (Is_icf_eligible(file, file.input_section_list[j], fold_rodata) == false || address_taken_list[i][j] == true)
+                continue;
+
+            eligible_idx_list[i][j] = isec_list.size();
+            isec_list.push_back(Eligible{i, &file.input_section_list[j]});
+        }
+    }
+
+    // what a relocation refers, an eligible section is compared by its equivalence class, 
+    // and others are compared by identity
+    struct Reloc_target
+    {
+        int32_t eligible_idx = -1;
+        const void *id = nullptr;
+        uint64_t val = 0;
+    };
+
+    auto get_target = [&](const Input_file &file, const nELF_util::ELF_Rel &rel) -> Reloc_target
+    {
+        const Symbol *sym = file.symbol_list[rel.sym()];
+        if (sym == nullptr)
+            return Reloc_target{};
+
+        if (Merged_section::Piece *piece = sym->piece())
+            return Reloc_target{-1, piece, sym->val};
+
+        const Input_file *def_file = nullptr;
+        const Input_section *target = Get_defining_section(ctx, file, *sym, &def_file);
+        
+        // an absolute local symbol is compared by its value, global symbols are shared by all files
+        if (target == nullptr)
+            return Reloc_target{-1, nELF_util::Is_sym_local(sym->elf_sym()) ? nullptr : sym, sym->val};
+
+        int32_t idx = eligible_idx_list[def_file - input_file_list.data()][target - def_file->input_section_list.data()];
+        if (idx == -1)
+            return Reloc_target{-1, target, sym->val};
+
+        return Reloc_target{idx, nullptr, sym->val};
+    };
+
+    // The initial digest covers contents and relocations, except the classes of eligible sections 
+    // which are referred. They are edges in the graph that the classes are refined on.
+    std::vector<uint64_t> digest_list(isec_list.size());
+    std::vector<std::vector<int32_t>> edge_list(isec_list.size());
+
+    nUtil::Parallel_for(isec_list.size(), [&](std::size_t i)
+    {
+        const Input_file &file = input_file_list[isec_list[i].file_idx];
+        const Input_section &isec = *isec_list[i].isec;
+
+        uint64_t digest = std::hash<std::string_view>{}(isec.data);
+        digest = Hash_combine(digest, isec.shdr().sh_type);
+        digest = Hash_combine(digest, isec.shdr().sh_flags);
+        digest = Hash_combine(digest, isec.shdr().sh_addralign);
+        digest = Hash_combine(digest, isec.rel_count());
+
+        for(std::size_t rel_idx = 0 ; rel_idx < isec.rel_count() ; rel_idx++)
+        {
+            nELF_util::ELF_Rel rel = isec.rela_at(rel_idx);
+            Reloc_target target = get_target(file, rel);
+
+            digest = Hash_combine(digest, rel.offset());
+            digest = Hash_combine(digest, rel.type());
+            digest = Hash_combine(digest, rel.r_addend);
+            digest = Hash_combine(digest, (uint64_t)target.id);
+            digest = Hash_combine(digest, target.val);
+            digest = Hash_combine(digest, target.eligible_idx != -1);
+
+            if (target.eligible_idx != -1)
+                edge_list[i].push_back(target.eligible_idx);
+        }
+
+        digest_list[i] = digest;
+    });
+
+    auto count_classes = [](std::vector<uint64_t> digests) -> std::size_t
+    {
+        std::sort(digests.begin(), digests.end());
+        return std::unique(digests.begin(), digests.end()) - digests.begin();
+    };
+
+    // Classes are only split by a round, and they are stable if the number of them doesn't change
+    std::size_t n_class = count_classes(digest_list);
+    std::size_t n_round = 0;
+    for(;;)
+    {
+        std::vector<uint64_t> next_digest_list(isec_list.size());
+
+        nUtil::Parallel_for(isec_list.size(), [&](std::size_t i)
+        {
+            uint64_t digest = digest_list[i];
+            for(int32_t target : edge_list[i])
+                digest = Hash_combine(digest, digest_list[target]);
+            next_digest_list[i] = digest;
+        });
+
+        digest_list.swap(next_digest_list);
+        n_round++;
+
+        std::size_t cnt = count_classes(digest_list);
+        if (cnt == n_class)
+            break;
+        n_class = cnt;
+    }
+
+    // Digests may collide, so a section is folded only if it's really identical to the leader
+    auto is_identical = [&](std::size_t a, std::size_t b) -> bool
+    {
+        const Input_file &file_a = input_file_list[isec_list[a].file_idx];
+        const Input_file &file_b = input_file_list[isec_list[b].file_idx];
+        const Input_section &isec_a = *isec_list[a].isec;
+        const Input_section &isec_b = *isec_list[b].isec;
+
+        if (   isec_a.data != isec_b.data
+            || isec_a.shdr().sh_type != isec_b.shdr().sh_type
+            || isec_a.shdr().sh_flags != isec_b.shdr().sh_flags
+            || isec_a.shdr().sh_addralign != isec_b.shdr().sh_addralign
+            || isec_a.rel_count() != isec_b.rel_count())
+            return false;
+
+        for(std::size_t rel_idx = 0 ; rel_idx < isec_a.rel_count() ; rel_idx++)
+        {
+            nELF_util::ELF_Rel rel_a = isec_a.rela_at(rel_idx);
+            nELF_util::ELF_Rel rel_b = isec_b.rela_at(rel_idx);
+
+            if (rel_a.offset() != rel_b.offset() || rel_a.type() != rel_b.type() || rel_a.r_addend != rel_b.r_addend)
+                return false;
+
+            Reloc_target target_a = get_target(file_a, rel_a);
+            Reloc_target target_b = get_target(file_b, rel_b);
+
+            if (target_a.val != target_b.val || (target_a.eligible_idx == -1) != (target_b.eligible_idx == -1))
+                return false;
+
+            if (target_a.eligible_idx == -1 && target_a.id != target_b.id)
+                return false;
+
+            if (target_a.eligible_idx != -1 && digest_list[target_a.eligible_idx] != digest_list[target_b.eligible_idx])
+                return false;
+        }
+
+        return true;
+    };
+
+    std::vector<std::size_t> order(isec_list.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b)
+    {
+        return digest_list[a] < digest_list[b];
+    });
+
+    // pairs of a leader and a section folded into it
+    std::vector<std::pair<std::size_t, std::size_t>> fold_list;
+
+    for(std::size_t begin = 0, end = 0 ; begin < order.size() ; begin = end)
+    {
+        for(end = begin + 1 ; end < order.size() && digest_list[order[end]] == digest_list[order[begin]] ; end++);
+
+        for(std::size_t k = begin + 1 ; k < end ; k++)
+        {
+            if (is_identical(order[begin], order[k]))
+                fold_list.emplace_back(order[begin], order[k]);
+        }
+    }
+
+    std::sort(fold_list.begin(), fold_list.end());
+
+    uint64_t saved_bytes = 0;
+    uint64_t saved_rodata_bytes = 0;
+    for(std::size_t i = 0 ; i < fold_list.size() ; i++)
+    {
+        auto [leader, member] = fold_list[i];
+        Input_file &file = input_file_list[isec_list[member].file_idx];
+        Input_section &isec = *isec_list[member].isec;
+
+        isec.leader = isec_list[leader].isec;
+        file.Discard_section(isec.shndx);
+        saved_bytes += isec.shdr().sh_size;
+        if ((isec.shdr().sh_flags & SHF_EXECINSTR) == 0)
+            saved_rodata_bytes += isec.shdr().sh_size;
+
+        if (ctx.link_option_args().print_icf_sections == false)
+            continue;
+
+        if (i == 0 || fold_list[i - 1].first != leader)
+        {
+            std::string_view name = input_file_list[isec_list[leader].file_idx].name();
+            fprintf(stderr, "selected section %.*s:(%.*s)\n", (int)name.size(), name.data(), 
+                                                               (int)isec.leader->name().size(), isec.leader->name().data());
+        }
+        fprintf(stderr, "  removing identical section %.*s:(%.*s)\n", (int)file.name().size(), file.name().data(), 
+                                                                       (int)isec.name().size(), isec.name().data());
+    }
+
+    if (ctx.link_option_args().print_icf_sections == false)
+        return;
+
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time);
+
+    fprintf(stderr, "icf: %lu of %lu sections folded, %lu bytes saved (%lu bytes of read-only data), %lu rounds, %.3f ms\n", 
+            fold_list.size(), isec_list.size(), saved_bytes, saved_rodata_bytes, n_round, elapsed.count());
+}
+
 void nLinking_passes::Combined_input_sections(Linking_context &ctx)
 {
     using counter_t = std::size_t;
@@ -179,10 +768,48 @@ void nLinking_passes::Combined_input_sections(Linking_context &ctx)
 
     std::vector<IN_OUT_section_bind> in_out_section_bind(isec_cnt);
 
-    for(const Input_file &input_file : ctx.input_file_list())
+    // With --zero-data-to-bss, .data and .sdata sections which contain only zeros and have no relocation 
+    // are placed in .bss and .sbss, so they take no space in the file. Files are scanned in parallel
+    std::vector<std::vector<bool>> is_zero_data_list(ctx.input_file_list().size());
+
+    if (ctx.link_option_args().zero_data_to_bss)
     {
-        for(const Input_section &isec : input_file.input_section_list)
+        nUtil::Parallel_for(ctx.input_file_list().size(), [&](std::size_t i)
         {
+            const Input_file &input_file = ctx.input_file_list()[i];
+            std::vector<bool> &is_zero_data = is_zero_data_list[i];
+
+            is_zero_data.resize(input_file.input_section_list.size());
+
+            for(std::size_t j = 0 ; j < input_file.input_section_list.size() ; j++)
+            {
+                const Input_section &isec = input_file.input_section_list[j];
+                auto &shdr = isec.shdr();
+
+                if (   input_file.relocate_state_list()[isec.shndx] != Input_file::eRelocate_state::relocatable
+                    || shdr.sh_type != SHT_PROGBITS
+                    || (shdr.sh_flags & (SHF_ALLOC | SHF_WRITE | SHF_EXECINSTR | SHF_TLS)) != (SHF_ALLOC | SHF_WRITE)
+                    || isec.rel_count() != 0
+                    || isec.data.empty())
+                    continue;
+
+                std::string_view name = nELF_util::get_output_name(isec.name(), shdr.sh_flags);
+                if (name != ".data" && name != ".sdata")
+                    continue;
+
+                is_zero_data[j] = std::all_of(isec.data.begin(), isec.data.end(), [](char c){return c == 0;});
+            }
+        });
+    }
+
+    for(std::size_t file_idx = 0 ; file_idx < ctx.input_file_list().size() ; file_idx++)
+    {
+        const Input_file &input_file = ctx.input_file_list()[file_idx];
+
+        for(std::size_t isec_idx = 0 ; isec_idx < input_file.input_section_list.size() ; isec_idx++)
+        {
+            const Input_section &isec = input_file.input_section_list[isec_idx];
+
             if (input_file.relocate_state_list()[isec.shndx] != Input_file::eRelocate_state::relocatable)
                 continue;
 
@@ -199,6 +826,9 @@ void nLinking_passes::Combined_input_sections(Linking_context &ctx)
             {
                 auto key = nLinking_passes::Get_output_section_key(ctx, isec, ctors_in_init_array);
 
+                if (is_zero_data_list[file_idx].empty() == false && is_zero_data_list[file_idx][isec_idx])
+                    key = Output_section_key{key.name == ".sdata" ? ".sbss" : ".bss", SHT_NOBITS};
+
                 Osec_bind_state *targ;
 
                 if (auto it = osec_map.find(key) ; it != osec_map.end())
@@ -222,28 +852,200 @@ void nLinking_passes::Combined_input_sections(Linking_context &ctx)
                     *(targ->sh_flag) |= sh_flags;
             };
 
-            merge_input_section();
-        }
+            merge_input_section();
+        }
+    }
+
+    for(auto &item : osec_map)
+    {
+        item.second.osec->shdr.sh_flags = *item.second.sh_flag;
+        item.second.osec->member_list.resize(*item.second.member_cnt);
+    }
+    
+    for(auto &obs : osec_map)
+       ctx.Insert_osec(std::unique_ptr<Output_section>(obs.second.osec));
+
+    // Add input sections to output sections
+    for(auto &io_bind : in_out_section_bind)
+    {
+        io_bind.osec->member_list[io_bind.member_offset].isec = io_bind.isec;
+        io_bind.osec->member_list[io_bind.member_offset].file = io_bind.owner_file;
+        //std::cout << io_bind.osec->name << " " << io_bind.member_offset << " " << io_bind.isec->shndx << "\n";
+    }
+}
+
+
+void nLinking_passes::Sort_output_section_members(Linking_context &ctx)
+{
+    const Link_option_args &args = ctx.link_option_args();
+
+    std::unordered_map<const Input_section*, std::size_t> priority_map;
+    
+    // the call graph profile is ignored if the order is given explicitly
+    if (args.symbol_ordering_file.empty() == false)
+        priority_map = Get_symbol_ordering_priority(ctx);
+    else if (args.call_graph_profile_sort)
+        priority_map = nCall_graph_sort::Compute_section_order(ctx);
+
+    std::unordered_map<const Input_section*, uint64_t> count_map;
+    if (args.data_access_profile.empty() == false)
+        count_map = Get_data_access_count(ctx);
+
+    std::unordered_set<const Input_section*> isolated_set;
+    for(auto [isec, idx] : Find_defining_sections(ctx, args.cache_line_isolate, "--cache-line-isolate"))
+        isolated_set.insert(isec);
+
+    if (   priority_map.empty() && count_map.empty() && isolated_set.empty() 
+        && args.keep_text_section_prefix == false && args.sort_section_alignment == false)
+        return;
+
+    std::vector<Output_section*> osec_list;
+    for(auto &[key, osec] : ctx.osec_pool())
+        osec_list.push_back(osec.get());
+
+    // sorted by name to report in a fixed order
+    std::sort(osec_list.begin(), osec_list.end(), [](const Output_section *a, const Output_section *b)
+    {
+        return a->name < b->name;
+    });
+
+    // padding bytes of each output section before and after sorting
+    std::vector<std::pair<std::size_t, std::size_t>> padding_list(osec_list.size());
+
+    nUtil::Parallel_for(osec_list.size(), [&](std::size_t i)
+    {
+        Output_section &osec = *osec_list[i];
+
+        // the access profile is applied to the small and normal data and bss sections
+        bool is_data =    osec.name == ".data" || osec.name == ".sdata" 
+                       || osec.name == ".bss" || osec.name == ".sbss";
+
+        bool is_packed = args.sort_section_alignment && Is_packable_section(osec);
+        if (is_packed)
+            padding_list[i].first = Get_padding_size(osec.member_list);
+
+        // -z keep-text-section-prefix groups .text.hot.*, .text.startup.* and so on, the priority
+        // orders sections in a group, then hot data is placed before cold data. Sections which are 
+        // still not ordered are packed from the largest alignment with --sort-section=alignment
+        auto get_key = [&](const Output_section::Member &member) -> std::tuple<std::size_t, std::size_t, uint64_t, uint64_t>
+        {
+            std::size_t rank = args.keep_text_section_prefix ? Get_text_prefix_rank(member.isec->name()) : 0;
+
+            auto it = priority_map.find(member.isec);
+            std::size_t priority = it == priority_map.end() ? (std::size_t)-1 : it->second;
+
+            auto it2 = count_map.find(member.isec);
+            uint64_t coldness = (is_data == false || it2 == count_map.end()) ? (uint64_t)-1 : ~it2->second;
+
+            uint64_t alignment = is_packed ? ~member.isec->shdr().sh_addralign : 0;
+
+            return {rank, priority, coldness, alignment};
+        };
+
+        std::stable_sort(osec.member_list.begin(), osec.member_list.end(), 
+                         [&](const Output_section::Member &a, const Output_section::Member &b)
+                         {
+                             return get_key(a) < get_key(b);
+                         });
+
+        for(Output_section::Member &member : osec.member_list)
+            member.is_isolated = isolated_set.count(member.isec) != 0;
+
+        if (is_packed)
+            padding_list[i].second = Get_padding_size(osec.member_list);
+    });
+
+    if (args.print_section_packing == false)
+        return;
+
+    for(std::size_t i = 0 ; i < osec_list.size() ; i++)
+    {
+        auto [before, after] = padding_list[i];
+        if (before == 0)
+            continue;
+
+        std::string_view name = osec_list[i]->name;
+        printf("section packing: %.*s: %lu bytes of padding, %lu bytes saved\n", 
+               (int)name.size(), name.data(), after, before - after);
+    }
+}
+
+void nLinking_passes::Align_functions(Linking_context &ctx)
+{
+    const Link_option_args &args = ctx.link_option_args();
+
+    // a section is aligned if a function begins at it, a function in the middle of a section 
+    // can't be aligned without inserting bytes into the section, that's what -ffunction-sections is for
+    auto is_function_entry = [](const Symbol &sym)
+    {
+        return sym.Get_type() == STT_FUNC && sym.val == 0;
+    };
+
+    std::vector<std::pair<const Input_section*, std::size_t>> found_list;
+
+    if (args.function_alignment_file.empty() == false)
+    {
+        std::vector<std::string> name_list = Read_name_list(args.function_alignment_file, "function alignment file");
+        found_list = Find_defining_sections(ctx, name_list, "function alignment file", is_function_entry);
+    }
+    else
+    {
+        found_list = Scan_defining_sections(ctx, [&](const Symbol &sym)
+        {
+            return is_function_entry(sym) ? std::size_t(0) : std::string::npos;
+        });
     }
 
-    for(auto &item : osec_map)
+    std::unordered_set<const Input_section*> aligned_set;
+    for(auto [isec, idx] : found_list)
     {
-        item.second.osec->shdr.sh_flags = *item.second.sh_flag;
-        item.second.osec->member_list.resize(*item.second.member_cnt);
+        if (isec->shdr().sh_flags & SHF_EXECINSTR)
+            aligned_set.insert(isec);
     }
-    
-    for(auto &obs : osec_map)
-       ctx.Insert_osec(std::unique_ptr<Output_section>(obs.second.osec));
 
-    // Add input sections to output sections
-    for(auto &io_bind : in_out_section_bind)
+    std::vector<Output_section*> osec_list;
+    for(auto &[key, osec] : ctx.osec_pool())
     {
-        io_bind.osec->member_list[io_bind.member_offset].isec = io_bind.isec;
-        io_bind.osec->member_list[io_bind.member_offset].file = io_bind.owner_file;
-        //std::cout << io_bind.osec->name << " " << io_bind.member_offset << " " << io_bind.isec->shndx << "\n";
+        if (osec->shdr.sh_flags & SHF_EXECINSTR)
+            osec_list.push_back(osec.get());
     }
+
+    nUtil::Parallel_for(osec_list.size(), [&](std::size_t i)
+    {
+        for(Output_section::Member &member : osec_list[i]->member_list)
+        {
+            if (aligned_set.count(member.isec) != 0)
+                member.entry_alignment = args.function_alignment;
+        }
+    });
 }
 
+void nLinking_passes::Print_function_alignment(const Linking_context &ctx)
+{
+    std::vector<const Output_section*> osec_list;
+    for(auto &[key, osec] : ctx.osec_pool())
+    {
+        if (osec->shdr.sh_flags & SHF_EXECINSTR)
+            osec_list.push_back(osec.get());
+    }
+
+    std::sort(osec_list.begin(), osec_list.end(), [](const Output_section *a, const Output_section *b)
+    {
+        return a->name < b->name;
+    });
+
+    for(const Output_section *osec : osec_list)
+    {
+        std::size_t n_aligned = std::count_if(osec->member_list.begin(), osec->member_list.end(), 
+                                              [](const Output_section::Member &member){return member.entry_alignment > 1;});
+        if (n_aligned == 0)
+            continue;
+
+        printf("function alignment: %.*s: %lu functions aligned to %lu bytes, %lu bytes of padding, %lu bytes in total\n", 
+               (int)osec->name.size(), osec->name.data(), n_aligned, ctx.link_option_args().function_alignment,
+               osec->entry_alignment_padding, osec->shdr.sh_size);
+    }
+}
 
 void nLinking_passes::Bind_special_symbols(Linking_context &ctx)
 {
@@ -273,6 +1075,14 @@ void nLinking_passes::Bind_special_symbols(Linking_context &ctx)
     assert(it != ctx.global_symbol_map().end());
     symbols.end = it->second.Mark_ref();
 
+    it = ctx.global_symbol_map().find(symbols.global_pointer_name) ; 
+    assert(it != ctx.global_symbol_map().end());
+    symbols.global_pointer = it->second.Mark_ref();
+
+    it = ctx.global_symbol_map().find(symbols.jvt_base_name) ; 
+    assert(it != ctx.global_symbol_map().end());
+    symbols.jvt_base = it->second.Mark_ref();
+
 
 }
 
@@ -281,20 +1091,55 @@ void nLinking_passes::Assign_input_section_offset(Linking_context &ctx)
 {
     for(auto &[p_osec, osec]: ctx.osec_pool())
     {
-        std::size_t offset = 0, p2align = 0;
+        std::size_t offset = 0;
+        uint64_t alignment = 1;
+        bool has_isolated = false;
+        osec->entry_alignment_padding = 0;
         for(std::size_t idx = 0 ; idx < osec->member_list.size() ; idx++)
         {
             auto &isec = *osec->member_list[idx].isec;
+            bool is_isolated = osec->member_list[idx].is_isolated;
+
+            // sh_addralign is 0 or 1 if there is no alignment constraint
+            uint64_t isec_alignment = std::max<uint64_t>(isec.shdr().sh_addralign, 1);
+
+            if (uint64_t entry_alignment = osec->member_list[idx].entry_alignment ; entry_alignment > isec_alignment)
+            {
+                osec->entry_alignment_padding += nUtil::align_to(offset, entry_alignment) - nUtil::align_to(offset, isec_alignment);
+                isec_alignment = entry_alignment;
+            }
+
+            offset = nUtil::align_to(offset, isec_alignment);
+
+            // an isolated member begins at a cache line, and the next member begins at the next one
+            if (is_isolated)
+                offset = nUtil::align_to(offset, ctx.link_option_args().cache_line_size);
 
-            offset = nUtil::align_to(offset, 1 << p2align);
             osec->member_list[idx].offset = offset;
+            isec.osec = osec.get();
+            isec.osec_offset = offset;
             
-            offset += isec.shdr().sh_size;
-            p2align = std::max(p2align, isec.shdr().sh_addralign);
+            offset += isec.size();
+            alignment = std::max(alignment, isec_alignment);
+
+            if (is_isolated)
+            {
+                offset = nUtil::align_to(offset, ctx.link_option_args().cache_line_size);
+                has_isolated = true;
+            }
+
+            if (Output_section::Thunk_batch *batch = osec->Get_thunk_batch(idx) ; batch != nullptr && batch->last_member_idx == idx)
+            {
+                offset = nUtil::align_to(offset, 4);
+                batch->offset = offset;
+                offset += batch->size();
+            }
         }
 
         osec->shdr.sh_size = offset;
-        osec->shdr.sh_addralign = 1 << p2align;
+        osec->shdr.sh_addralign = alignment;
+        if (has_isolated)
+            osec->shdr.sh_addralign = std::max<uint64_t>(osec->shdr.sh_addralign, ctx.link_option_args().cache_line_size);
     }
 }
 
@@ -309,6 +1154,197 @@ void nLinking_passes::Create_synthetic_sections(Linking_context &ctx)
     ctx.riscv_attributes_section = ctx.Insert_chunk(std::make_unique<Riscv_attributes_section>());
 }
 
+void nLinking_passes::Create_got(Linking_context &ctx)
+{
+    const std::vector<Input_file> &input_file_list = ctx.input_file_list();
+
+    // symbols referred through GOT by each file, files are scanned in parallel
+    std::vector<std::vector<Symbol*>> got_sym_list(input_file_list.size());
+
+    nUtil::Parallel_for(input_file_list.size(), [&](std::size_t i)
+    {
+        const Input_file &file = input_file_list[i];
+
+        for(const Input_section &isec : file.input_section_list)
+        {
+            if (   isec.relsec_idx() == (std::size_t)-1 
+                || (isec.shdr().sh_flags & SHF_ALLOC) == 0
+                || file.relocate_state_list()[isec.shndx] == Input_file::eRelocate_state::no_need)
+                continue;
+
+            for(std::size_t rel_idx = 0 ; rel_idx < isec.rel_count() ; rel_idx++)
+            {
+                nELF_util::ELF_Rel rel = isec.rela_at(rel_idx);
+
+                if (   rel.type() != (std::size_t)eReloc_type::R_RISCV_GOT_HI20
+                    || nRelocation::Is_got_relaxable(ctx, file, isec, rel_idx) == true)
+                    continue;
+
+                Symbol *sym = file.symbol_list[rel.sym()];
+                if (sym == nullptr)
+                    FATALF("%s", "why this symbol is not binded?");
+
+                got_sym_list[i].push_back(sym);
+            }
+        }
+    });
+
+    // Slots are assigned in the order of files, so the output is reproducible 
+    // no matter how the scan is scheduled.
+    for(std::size_t i = 0 ; i < input_file_list.size() ; i++)
+    {
+        for(Symbol *sym : got_sym_list[i])
+        {
+            if (ctx.got == nullptr)
+                ctx.got = ctx.Insert_chunk(std::make_unique<Got_section>());
+            
+            ctx.got->Add_symbol(*sym, input_file_list[i]);
+        }
+    }
+}
+
+void nLinking_passes::Create_jvt(Linking_context &ctx)
+{
+    if (ctx.link_option_args().relax == false || ctx.link_option_args().relax_tbljal == false)
+        return;
+
+    struct Call_count
+    {
+        Symbol *sym;
+        const Input_file *file;
+        uint64_t n_tail_call; // cm.jt candidates
+        uint64_t n_call;      // cm.jalt candidates
+    };
+
+    const std::vector<Input_file> &input_file_list = ctx.input_file_list();
+
+    // Calls are counted per file in parallel, targets are kept in the order they are first called,
+    // so that the table is reproducible.
+    std::vector<std::vector<Call_count>> count_list(input_file_list.size());
+
+    nUtil::Parallel_for(input_file_list.size(), [&](std::size_t i)
+    {
+        const Input_file &file = input_file_list[i];
+        std::unordered_map<const Symbol*, std::size_t> pos_map;
+
+        for(const Input_section &isec : file.input_section_list)
+        {
+            if (   isec.relsec_idx() == (std::size_t)-1 
+                || (isec.shdr().sh_flags & SHF_EXECINSTR) == 0
+                || file.relocate_state_list()[isec.shndx] == Input_file::eRelocate_state::no_need)
+                continue;
+
+            for(std::size_t rel_idx = 0 ; rel_idx < isec.rel_count() ; rel_idx++)
+            {
+                bool is_link;
+                Symbol *sym = nRelocation::Get_table_jump_target(ctx, file, isec, rel_idx, &is_link);
+                if (sym == nullptr)
+                    continue;
+
+                auto [it, is_new] = pos_map.insert({sym, count_list[i].size()});
+                if (is_new == true)
+                    count_list[i].push_back(Call_count{sym, &file, 0, 0});
+
+                if (is_link == true)
+                    count_list[i][it->second].n_call++;
+                else
+                    count_list[i][it->second].n_tail_call++;
+            }
+        }
+    });
+
+    std::vector<Call_count> total_count_list;
+    std::unordered_map<const Symbol*, std::size_t> pos_map;
+
+    for(std::size_t i = 0 ; i < count_list.size() ; i++)
+    {
+        for(const Call_count &cnt : count_list[i])
+        {
+            auto [it, is_new] = pos_map.insert({cnt.sym, total_count_list.size()});
+            if (is_new == true)
+                total_count_list.push_back(Call_count{cnt.sym, cnt.file, 0, 0});
+
+            total_count_list[it->second].n_tail_call += cnt.n_tail_call;
+            total_count_list[it->second].n_call += cnt.n_call;
+        }
+    }
+
+    // A table jump is 2 bytes, while the call would be relaxed to a 4-byte jal in most cases, 
+    // and every entry costs 8 bytes in the table. 
+    auto get_gain = [](uint64_t n_site)->int64_t
+    {
+        return (int64_t)n_site * 2 - (int64_t)sizeof(Elf64_Addr);
+    };
+
+    int64_t threshold = ctx.link_option_args().relax_tbljal_threshold;
+
+    auto select = [&](bool is_link, std::size_t max_cnt)
+    {
+        std::vector<const Call_count*> vec;
+        for(const Call_count &cnt : total_count_list)
+        {
+            if (get_gain(is_link ? cnt.n_call : cnt.n_tail_call) >= threshold)
+                vec.push_back(&cnt);
+        }
+
+        std::stable_sort(vec.begin(), vec.end(), [is_link](const Call_count *a, const Call_count *b)
+        {
+            return is_link ? a->n_call > b->n_call : a->n_tail_call > b->n_tail_call;
+        });
+
+        if (vec.size() > max_cnt)
+            vec.resize(max_cnt);
+        return vec;
+    };
+
+    std::vector<const Call_count*> jt_list = select(false, Jvt_section::gJT_ENTRY_CNT);
+    std::vector<const Call_count*> jalt_list = select(true, Jvt_section::gMAX_ENTRY_CNT - Jvt_section::gJT_ENTRY_CNT);
+
+    int64_t jt_gain = 0;
+    for(const Call_count *cnt : jt_list)
+        jt_gain += get_gain(cnt->n_tail_call);
+
+    // entries for cm.jalt start at 32, so unused entries for cm.jt are wasted if cm.jalt is used
+    int64_t jalt_gain = -(int64_t)((Jvt_section::gJT_ENTRY_CNT - jt_list.size()) * sizeof(Elf64_Addr));
+    for(const Call_count *cnt : jalt_list)
+        jalt_gain += get_gain(cnt->n_call);
+
+    if (jalt_gain <= 0)
+        jalt_list.clear();
+    if (jt_gain + (jalt_list.empty() ? 0 : jalt_gain) <= 0)
+        return;
+
+    ctx.jvt = ctx.Insert_chunk(std::make_unique<Jvt_section>());
+    bool is_printed = ctx.link_option_args().print_table_jump;
+
+    for(const Call_count *cnt : jt_list)
+    {
+        ctx.jvt->jt_index_map[cnt->sym] = ctx.jvt->entry_list.size();
+        if (is_printed)
+            fprintf(stderr, "table jump: cm.jt   %3lu %s, %lu sites, %ld bytes saved\n", 
+                    ctx.jvt->entry_list.size(), std::string(cnt->sym->name).c_str(), cnt->n_tail_call, get_gain(cnt->n_tail_call));
+        ctx.jvt->entry_list.push_back(Jvt_section::Entry{cnt->sym, cnt->file});
+    }
+
+    if (jalt_list.empty() == false)
+        ctx.jvt->entry_list.resize(Jvt_section::gJT_ENTRY_CNT, Jvt_section::Entry{nullptr, nullptr});
+
+    for(const Call_count *cnt : jalt_list)
+    {
+        ctx.jvt->jalt_index_map[cnt->sym] = ctx.jvt->entry_list.size();
+        if (is_printed)
+            fprintf(stderr, "table jump: cm.jalt %3lu %s, %lu sites, %ld bytes saved\n", 
+                    ctx.jvt->entry_list.size(), std::string(cnt->sym->name).c_str(), cnt->n_call, get_gain(cnt->n_call));
+        ctx.jvt->entry_list.push_back(Jvt_section::Entry{cnt->sym, cnt->file});
+    }
+
+    ctx.jvt->shdr.sh_size = ctx.jvt->entry_list.size() * sizeof(Elf64_Addr);
+
+    if (is_printed)
+        fprintf(stderr, "table jump: %lu entries, %ld bytes saved in total\n", 
+                ctx.jvt->entry_list.size(), jt_gain + (jalt_list.empty() ? 0 : jalt_gain));
+}
+
 void nLinking_passes::Sort_output_sections(Linking_context &ctx)
 {
     auto get_rank1 = [&ctx](const Chunk *chunk)->int32_t
@@ -348,6 +1384,17 @@ void nLinking_passes::Sort_output_sections(Linking_context &ctx)
             return 3;
         if (chunk->name == ".alpha_got")
             return 4;
+
+        // Small data sections are put at the end of writable PROGBITS sections
+        // and at the beginning of NOBITS sections, so that they are next to each other 
+        // and __global_pointer$ reaches as many of them as possible.
+        if (shdr.sh_flags & SHF_WRITE)
+        {
+            if (chunk->name == ".sdata")
+                return INT32_MAX;
+            if (chunk->name == ".sbss")
+                return -1;
+        }
         return 0;
     };
 
@@ -424,42 +1471,343 @@ void nLinking_passes::Compute_section_headers(Linking_context &ctx)
     // Remove empty chunks.
     for(auto it = ctx.output_chunk_list.begin() ; it != ctx.output_chunk_list.end() ;)
     {
-        if (it->is_osec() == false && it->chunk().shdr.sh_size == 0)
-            it = ctx.output_chunk_list.erase(it);
-        else
-            ++it;
+        if (it->is_osec() == false && it->chunk().shdr.sh_size == 0)
+            it = ctx.output_chunk_list.erase(it);
+        else
+            ++it;
+    }
+
+    // Set section indices.
+    // section index 0 is reserved as an undefined value
+    int64_t shndx = 1;
+    for (auto &output_chunk : ctx.output_chunk_list)
+    {
+        if (output_chunk.chunk().is_header() == false)
+            output_chunk.chunk().shndx = shndx++;
+    }
+    
+    if (ctx.symtab_section && SHN_LORESERVE <= shndx)
+    {
+        Symtab_shndx_section *sec = new Symtab_shndx_section;
+        sec->shndx = shndx++;
+        sec->shdr.sh_link = ctx.symtab_section->shndx;
+        ctx.symtab_shndx_section = ctx.Insert_chunk(std::unique_ptr<Symtab_shndx_section>(sec));
+    }
+
+    if (ctx.shdr)
+        ctx.shdr->shdr.sh_size = shndx * sizeof(elf64_shdr);
+    
+    // Some types of section header refer other section by index.
+    // Recompute the section header to fill such fields with correct values.
+    for (auto &output_chunk : ctx.output_chunk_list)
+        output_chunk.Update_shdr();
+
+    if (ctx.symtab_shndx_section)
+    {
+        std::size_t symtab_size = ctx.symtab_section->shdr.sh_size / sizeof(elf64_sym);
+        ctx.symtab_shndx_section->shdr.sh_size = symtab_size * 4;
+    }
+}
+
+// copied from mold, sections which are kept by --gc-sections even if nothing refers them
+static bool Is_gc_root(const Input_section &isec)
+{
+    auto &shdr = isec.shdr();
+    std::string_view name = isec.name();
+
+    if (shdr.sh_flags & SHF_GNU_RETAIN)
+        return true;
+
+    if (   shdr.sh_type == SHT_INIT_ARRAY || shdr.sh_type == SHT_FINI_ARRAY 
+        || shdr.sh_type == SHT_PREINIT_ARRAY || shdr.sh_type == SHT_NOTE)
+        return true;
+
+    for(std::string_view prefix : {".ctors", ".dtors", ".init", ".fini"})
+    {
+        if (name.rfind(prefix, 0) == 0)
+            return true;
+    }
+
+    // __start_<name> and __stop_<name> may refer sections whose name is a C identifier
+    return Is_c_identifier(name);
+}
+
+// the names in a file listed one per line, blank lines are skipped
+static std::vector<std::string> Read_name_list(const std::string &path, const char *what)
+{
+    std::ifstream fin(path);
+    if (fin.is_open() == false)
+        FATALF("cannot open the %s: %s", what, path.c_str());
+
+    std::vector<std::string> name_list;
+
+    for(std::string line ; std::getline(fin, line) ; )
+    {
+        std::size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos)
+            continue;
+        name_list.push_back(line.substr(begin, line.find_last_not_of(" \t\r") + 1 - begin));
+    }
+
+    return name_list;
+}
+
+// find the sections which define the symbols for which 'get_index' doesn't return npos, files are scanned 
+// in parallel. Pairs of a section and the index are returned in the order of files
+static std::vector<std::pair<const Input_section*, std::size_t>> 
+Scan_defining_sections(const Linking_context &ctx, const std::function<std::size_t(const Symbol&)> &get_index)
+{
+    const std::vector<Input_file> &input_file_list = ctx.input_file_list();
+
+    std::vector<std::vector<std::pair<const Input_section*, std::size_t>>> found_list(input_file_list.size());
+
+    nUtil::Parallel_for(input_file_list.size(), [&](std::size_t i)
+    {
+        const Input_file &file = input_file_list[i];
+
+        for(std::size_t sym_idx = 1 ; sym_idx < file.symbol_list.size() ; sym_idx++)
+        {
+            const Symbol *sym = file.symbol_list[sym_idx];
+
+            // a global symbol is looked up in the file which defines it
+            if (sym == nullptr || (sym_idx >= file.n_local_sym() && sym->file() != &file.src()))
+                continue;
+
+            std::size_t idx = get_index(*sym);
+            if (idx == std::string::npos)
+                continue;
+
+            const Input_file *def_file = nullptr;
+            const Input_section *isec = nLinking_passes::Get_defining_section(ctx, file, *sym, &def_file);
+            if (isec == nullptr)
+                continue;
+
+            if (isec->leader != nullptr)
+                isec = isec->leader; // folded by --icf
+
+            found_list[i].emplace_back(isec, idx);
+        }
+    });
+
+    std::vector<std::pair<const Input_section*, std::size_t>> ret;
+    for(auto &found : found_list)
+        ret.insert(ret.end(), found.begin(), found.end());
+
+    return ret;
+}
+
+// find the sections which define the symbols named in 'name_list' and accepted by 'is_wanted' if it's given. 
+// Pairs of a section and the index of the name are returned in the order of files, and a warning which 
+// begins with 'what' is printed for each name which no symbol has
+static std::vector<std::pair<const Input_section*, std::size_t>> 
+Find_defining_sections(const Linking_context &ctx, const std::vector<std::string> &name_list, const char *what,
+                       const std::function<bool(const Symbol&)> &is_wanted)
+{
+    std::unordered_map<std::string_view, std::size_t> name_map;
+    for(std::size_t i = 0 ; i < name_list.size() ; i++)
+        name_map.insert(std::make_pair(std::string_view(name_list[i]), i));
+
+    auto is_found = std::make_unique<std::atomic<bool>[]>(name_list.size());
+
+    auto ret = Scan_defining_sections(ctx, [&](const Symbol &sym) -> std::size_t
+    {
+        auto it = name_map.find(sym.name);
+        if (it == name_map.end())
+            return std::string::npos;
+
+        is_found[it->second] = true;
+
+        if (is_wanted != nullptr && is_wanted(sym) == false)
+            return std::string::npos;
+
+        return it->second;
+    });
+
+    for(std::size_t i = 0 ; i < name_list.size() ; i++)
+    {
+        // a name listed twice is found by the index of the first one
+        if (is_found[i] == false && name_map[name_list[i]] == i)
+            fprintf(stderr, "warning: %s: no such symbol: %s\n", what, name_list[i].c_str());
+    }
+
+    return ret;
+}
+
+// the priority of each section which defines a symbol listed in --symbol-ordering-file, 
+// it's the line number of the first symbol listed in the file which the section defines
+static std::unordered_map<const Input_section*, std::size_t> Get_symbol_ordering_priority(const Linking_context &ctx)
+{
+    std::vector<std::string> name_list = Read_name_list(ctx.link_option_args().symbol_ordering_file, "symbol ordering file");
+
+    std::unordered_map<const Input_section*, std::size_t> priority_map;
+    for(auto [isec, priority] : Find_defining_sections(ctx, name_list, "symbol ordering file"))
+    {
+        auto [it, is_inserted] = priority_map.insert(std::make_pair(isec, priority));
+        if (is_inserted == false)
+            it->second = std::min(it->second, priority);
+    }
+
+    return priority_map;
+}
+
+// the access count of each section which defines symbols listed in --data-access-profile, 
+// counts of symbols in the same section are summed up
+static std::unordered_map<const Input_section*, uint64_t> Get_data_access_count(const Linking_context &ctx)
+{
+    const std::string &path = ctx.link_option_args().data_access_profile;
+
+    std::ifstream fin(path);
+    if (fin.is_open() == false)
+        FATALF("cannot open the data access profile: %s", path.c_str());
+
+    // counts of a name listed more than once are summed up, the name is kept at its first line
+    std::unordered_map<std::string, std::size_t> name_map;
+    std::vector<std::string> name_list;
+    std::vector<uint64_t> count_list;
+
+    for(std::string line ; std::getline(fin, line) ; )
+    {
+        std::istringstream fields(line);
+        std::string name;
+        uint64_t count = 0;
+
+        if (!(fields >> name))
+            continue;
+
+        if (!(fields >> count))
+            FATALF("malformed line in the data access profile: %s", line.c_str());
+
+        auto [it, is_inserted] = name_map.insert(std::make_pair(name, name_list.size()));
+        if (is_inserted)
+        {
+            name_list.push_back(std::move(name));
+            count_list.push_back(0);
+        }
+
+        count_list[it->second] += count;
+    }
+
+    std::unordered_map<const Input_section*, uint64_t> count_map;
+    for(auto [isec, idx] : Find_defining_sections(ctx, name_list, "data access profile"))
+        count_map[isec] += count_list[idx];
+
+    return count_map;
+}
+
+// the rank of the group of an executable section by the prefix of its name, GCC puts functions in 
+// .text.hot.*, .text.unlikely.* and so on by profiles or attributes. The hot code is placed first,
+// then the code without a known prefix, and the code which is run once or rarely is placed last
+static std::size_t Get_text_prefix_rank(std::string_view name)
+{
+    static const std::string_view prefixes[] = 
+    {
+        ".text.hot", "", ".text.startup", ".text.exit", ".text.unlikely", ".text.split"
+    };
+
+    for(std::size_t i = 0 ; i < std::size(prefixes) ; i++)
+    {
+        std::string_view prefix = prefixes[i];
+
+        // ".text.hot" or ".text.hot.<name>", but not ".text.hotter" which is the function "hotter"
+        if (   prefix.empty() == false 
+            && name.rfind(prefix, 0) == 0 
+            && (name.size() == prefix.size() || name[prefix.size()] == '.'))
+            return i;
+    }
+
+    return 1;
+}
+
+// members of these output sections can be placed in any order, .eh_frame and .ctors/.dtors
+// are not, for example, their terminators have to be the last ones
+static bool Is_packable_section(const Output_section &osec)
+{
+    for(std::string_view name : {".rodata", ".srodata", ".data", ".sdata", ".bss", ".sbss", ".tdata", ".tbss"})
+    {
+        if (osec.name == name)
+            return true;
     }
+    return false;
+}
 
-    // Set section indices.
-    // section index 0 is reserved as an undefined value
-    int64_t shndx = 1;
-    for (auto &output_chunk : ctx.output_chunk_list)
+// bytes inserted between members of 'member_list' for their alignments if they are laid out in order
+static std::size_t Get_padding_size(const std::vector<Output_section::Member> &member_list)
+{
+    std::size_t offset = 0, padding = 0;
+    for(const Output_section::Member &member : member_list)
     {
-        if (output_chunk.chunk().is_header() == false)
-            output_chunk.chunk().shndx = shndx++;
+        std::size_t aligned = nUtil::align_to(offset, std::max<uint64_t>(member.isec->shdr().sh_addralign, 1));
+        padding += aligned - offset;
+        offset = aligned + member.isec->size();
     }
-    
-    if (ctx.symtab_section && SHN_LORESERVE <= shndx)
+    return padding;
+}
+
+static bool Is_c_identifier(std::string_view name)
+{
+    if (name.empty() || (isalpha(name[0]) == 0 && name[0] != '_'))
+        return false;
+
+    for(char c : name)
     {
-        Symtab_shndx_section *sec = new Symtab_shndx_section;
-        sec->shndx = shndx++;
-        sec->shdr.sh_link = ctx.symtab_section->shndx;
-        ctx.symtab_shndx_section = ctx.Insert_chunk(std::unique_ptr<Symtab_shndx_section>(sec));
+        if (isalnum(c) == 0 && c != '_')
+            return false;
     }
+    return true;
+}
 
-    if (ctx.shdr)
-        ctx.shdr->shdr.sh_size = shndx * sizeof(elf64_shdr);
-    
-    // Some types of section header refer other section by index.
-    // Recompute the section header to fill such fields with correct values.
-    for (auto &output_chunk : ctx.output_chunk_list)
-        output_chunk.Update_shdr();
+// copied from mold, code is folded, and so is read-only data if 'fold_rodata' is true. Sections 
+// which may be enumerated by __start_/__stop_ symbols or run by the startup code are never folded
+static bool Is_icf_eligible(const Input_file &file, const Input_section &isec, bool fold_rodata)
+{
+    auto &shdr = isec.shdr();
+    std::string_view name = isec.name();
 
-    if (ctx.symtab_shndx_section)
+    if (file.relocate_state_list()[isec.shndx] != Input_file::eRelocate_state::relocatable)
+        return false;
+
+    bool is_alloc = (shdr.sh_flags & SHF_ALLOC);
+    bool is_exec = (shdr.sh_flags & SHF_EXECINSTR) || name.rfind(".text", 0) == 0;
+    bool is_readonly = !(shdr.sh_flags & SHF_WRITE);
+    bool is_bss = (shdr.sh_type == SHT_NOBITS);
+    bool is_empty = (shdr.sh_size == 0);
+    bool is_init = (shdr.sh_type == SHT_INIT_ARRAY || name == ".init");
+    bool is_fini = (shdr.sh_type == SHT_FINI_ARRAY || name == ".fini");
+
+    if (!is_alloc || !is_readonly || is_bss || is_empty || is_init || is_fini || Is_c_identifier(name))
+        return false;
+
+    if (is_exec)
+        return true;
+
+    // constant tables in non-mergeable sections, e.g. .rodata.<name>, the contents of 
+    // SHF_MERGE sections are already merged piece by piece
+    bool is_rodata = shdr.sh_type == SHT_PROGBITS && (shdr.sh_flags & (SHF_MERGE | SHF_TLS)) == 0;
+
+    return fold_rodata && is_rodata;
+}
+
+// the same as boost::hash_combine, but with a 64-bit constant
+static uint64_t Hash_combine(uint64_t seed, uint64_t val)
+{
+    return seed ^ (std::hash<uint64_t>{}(val) + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+}
+
+const Input_section* nLinking_passes::Get_defining_section(const Linking_context &ctx, const Input_file &file, const Symbol &sym, const Input_file **def_file)
+{
+    if (sym.piece() != nullptr || nELF_util::Is_sym_undef(sym.elf_sym()) || nELF_util::Is_sym_abs(sym.elf_sym()))
+        return nullptr;
+
+    *def_file = &file;
+    if (nELF_util::Is_sym_local(sym.elf_sym()) == false)
     {
-        std::size_t symtab_size = ctx.symtab_section->shdr.sh_size / sizeof(elf64_sym);
-        ctx.symtab_shndx_section->shdr.sh_size = symtab_size * 4;
+        auto it = ctx.global_symbol_map().find(sym.name);
+        if (it == ctx.global_symbol_map().end() || it->second.input_file == nullptr)
+            return nullptr;
+        *def_file = it->second.input_file;
     }
+
+    return (*def_file)->Get_input_section((*def_file)->src().get_shndx(sym.elf_sym()));
 }
 
 static bool Is_tbss(const Chunk *chunk)
@@ -511,7 +1859,18 @@ static void Set_virtual_addresses(Linking_context &ctx)
             
             if (flags1 != flags2)
             {
-                if (addr % ctx.page_size != 0)
+                uint64_t align = nLinking_context_helper::Get_segment_alignment(ctx, it->chunk());
+                bool is_code = (flags1 | flags2) & (uint64_t)eSegment_flag::PF_X;
+
+                // a huge page aligned segment begins at a huge page boundary, and with -z separate-code
+                // an executable segment begins and ends at page boundaries. Otherwise a segment begins 
+                // at the next page of the end of the previous one, so that they share a page in the file, 
+                // or right after it with -n/-N.
+                if (align > ctx.page_size)
+                    addr = nUtil::align_to(addr, align);
+                else if (align == ctx.page_size && ctx.link_option_args().separate_code && is_code)
+                    addr = nUtil::align_to(addr, ctx.page_size);
+                else if (align == ctx.page_size && addr % ctx.page_size != 0)
                     addr += ctx.page_size;
             }
         }
@@ -591,10 +1950,12 @@ static std::size_t Set_file_offsets(Linking_context &ctx)
             continue;
         }
 
-        if (first.shdr.sh_addralign > ctx.page_size)
+        uint64_t segment_alignment = nLinking_context_helper::Get_segment_alignment(ctx, first);
+
+        if (first.shdr.sh_addralign > segment_alignment)
             fileoff = nUtil::align_to(fileoff, first.shdr.sh_addralign);
         else
-            fileoff = Align_with_skew(fileoff, ctx.page_size, first.shdr.sh_addr);
+            fileoff = Align_with_skew(fileoff, segment_alignment, first.shdr.sh_addr);
 
 
         // Assign ALLOC sections contiguous file offsets as long as they
@@ -660,8 +2021,148 @@ static std::size_t Set_file_offsets(Linking_context &ctx)
   }
 }
 
+bool nLinking_passes::Create_thunks(Linking_context &ctx)
+{
+    std::vector<std::pair<Output_section*, std::size_t>> job_list;
+
+    for(auto &[key, osec] : ctx.osec_pool())
+    {
+        if ((osec->shdr.sh_flags & SHF_EXECINSTR) == 0 || osec->member_list.empty())
+            continue;
+
+        // Members are grouped by their offsets when thunks are created for the first time, on the layout before 
+        // any byte is removed, and the batches are kept in the later passes. A batch spans at most gTHUNK_BATCH_SIZE 
+        // bytes, half of the range of JAL. A member is never larger than it's on that layout, and aligning up is 
+        // monotonic, so the offset of a member from the start of its batch never grows. The thunks of a batch are 
+        // placed right after it, so they stay in the range of JAL from any member of it while the layout converges.
+        if (osec->thunk_batch_list.empty())
+        {
+            std::size_t batch_begin = 0;
+            for(std::size_t i = 0 ; i < osec->member_list.size() ; i++)
+            {
+                const Output_section::Member &member = osec->member_list[i];
+                bool is_last = (i + 1 == osec->member_list.size());
+
+                if (   is_last == true
+                    || osec->member_list[i + 1].offset + osec->member_list[i + 1].isec->size() - batch_begin > gTHUNK_BATCH_SIZE)
+                {
+                    osec->thunk_batch_list.push_back(Output_section::Thunk_batch{});
+                    osec->thunk_batch_list.back().last_member_idx = i;
+                    batch_begin = member.offset + member.isec->size();
+                }
+            }
+        }
+
+        for(std::size_t i = 0 ; i < osec->member_list.size() ; i++)
+        {
+            if (osec->member_list[i].isec->rel_count() != 0)
+                job_list.push_back({osec.get(), i});
+        }
+    }
+
+    // jumps are scanned in parallel on the current layout
+    std::vector<std::vector<Output_section::Thunk_batch::Entry>> target_list(job_list.size());
+
+    nUtil::Parallel_for(job_list.size(), [&](std::size_t i)
+    {
+        nRelocation::Scan_thunk_targets(ctx, *job_list[i].first, job_list[i].second, target_list[i]);
+    });
+
+    // Thunks are never removed, so the layout converges as relaxation does.
+    bool is_changed = false;
+
+    for(std::size_t i = 0 ; i < job_list.size() ; i++)
+    {
+        Output_section::Thunk_batch &batch = *job_list[i].first->Get_thunk_batch(job_list[i].second);
+
+        for(const Output_section::Thunk_batch::Entry &entry : target_list[i])
+        {
+            if (batch.index_map.insert({entry.sym, batch.entry_list.size()}).second == true)
+            {
+                batch.entry_list.push_back(entry);
+                is_changed = true;
+            }
+        }
+    }
+
+    return is_changed;
+}
+
+bool nLinking_passes::Relax_sections(Linking_context &ctx)
+{
+    std::vector<std::pair<const Output_section*, std::size_t>> job_list;
+
+    for(auto &[key, osec] : ctx.osec_pool())
+    {
+        if ((osec->shdr.sh_flags & SHF_EXECINSTR) == 0)
+            continue;
+
+        for(std::size_t i = 0 ; i < osec->member_list.size() ; i++)
+        {
+            if (osec->member_list[i].isec->rel_count() != 0)
+                job_list.push_back({osec.get(), i});
+        }
+    }
+
+    bool relax = ctx.link_option_args().relax;
+
+    // Every section is relaxed on the layout of the previous pass, so new 
+    // r_deltas are not visible to other sections until all of them are computed.
+    std::vector<std::vector<uint32_t>> r_deltas_list(job_list.size());
+    std::vector<std::vector<uint32_t>> rewritten_rel_list(job_list.size());
+
+    nUtil::Parallel_for(job_list.size(), [&](std::size_t i)
+    {
+        nRelocation::Relax_section(ctx, *job_list[i].first, job_list[i].second, relax, r_deltas_list[i], rewritten_rel_list[i]);
+    });
+
+    bool is_changed = false;
+
+    for(std::size_t i = 0 ; i < job_list.size() ; i++)
+    {
+        const Input_section &isec = *job_list[i].first->member_list[job_list[i].second].isec;
+
+        if (r_deltas_list[i].back() == 0)
+            r_deltas_list[i].clear();
+
+        if (r_deltas_list[i] != isec.r_deltas)
+        {
+            isec.r_deltas = std::move(r_deltas_list[i]);
+            is_changed = true;
+        }
+
+        if (rewritten_rel_list[i] != isec.rewritten_rel_list)
+        {
+            isec.rewritten_rel_list = std::move(rewritten_rel_list[i]);
+            is_changed = true;
+        }
+    }
+
+    return is_changed;
+}
+
 void nLinking_passes::Fix_up_synthetic_symbols(Linking_context &ctx)
 {
+    // __global_pointer$ is 0x800 bytes after the start of small data sections, 
+    // so that a signed 12-bit offset from gp covers 4 KiB of them
+    auto sdata = std::find_if(ctx.output_chunk_list.begin(), 
+                              ctx.output_chunk_list.end(), 
+                              [](const Output_chunk &chk){return chk.chunk().name == ".sdata" || chk.chunk().name == ".sbss";});
+
+    if (sdata != ctx.output_chunk_list.end())
+        ctx.special_symbols.global_pointer->val = sdata->chunk().shdr.sh_addr + 0x800;
+
+    // On RISC-V, tp points to the beginning of the TLS block of a thread
+    auto tls = std::find_if(ctx.output_chunk_list.begin(), 
+                            ctx.output_chunk_list.end(), 
+                            [](const Output_chunk &chk){return (chk.chunk().shdr.sh_flags & SHF_TLS) && (chk.chunk().shdr.sh_flags & SHF_ALLOC);});
+
+    if (tls != ctx.output_chunk_list.end())
+        ctx.tp_addr = tls->chunk().shdr.sh_addr;
+
+    if (ctx.jvt != nullptr)
+        ctx.special_symbols.jvt_base->val = ctx.jvt->shdr.sh_addr;
+
     auto it = std::find_if(ctx.output_chunk_list.begin(), 
                            ctx.output_chunk_list.end(), 
                            [&ctx](const Output_chunk &chk){return chk.chunk().name == ".bss";});
@@ -713,373 +2214,53 @@ void nLinking_passes::Copy_chunks(Linking_context &ctx)
     }
 }
 
-static void write_itype(uint8_t *loc, uint32_t val)
-{
-    *(uint32_t *)loc &= 0b000000'00000'11111'111'11111'1111111;
-    *(uint32_t *)loc |= nUtil::EPOI(val, 11, 0) << 20;
-}
-
-static void write_stype(uint8_t *loc, uint32_t val)
-{
-    *(uint32_t *)loc &= 0b000000'11111'11111'111'00000'1111111;
-    *(uint32_t *)loc |= nUtil::EPOI(val, 11, 5) << 25 
-                    | nUtil::EPOI(val, 4, 0) << 7;
-}
-
-static void write_btype(uint8_t *loc, uint32_t val)
-{
-    *(uint32_t *)loc &= 0b000000'11111'11111'111'00000'1111111;
-    *(uint32_t *)loc |= nUtil::bit(val, 12) << 31 
-                    | nUtil::EPOI(val, 10, 5) << 25 
-                    | nUtil::EPOI(val, 4, 1) << 8
-                    | nUtil::bit(val, 11) << 7;
-}
-
-static void write_utype(uint8_t *loc, uint32_t val)
-{
-    *(uint32_t *)loc &= 0b000000'00000'00000'000'11111'1111111;
-
-    // U-type instructions are used in combination with I-type
-    // instructions. U-type insn sets an immediate to the upper 20-bits
-    // of a register. I-type insn sign-extends a 12-bits immediate and
-    // adds it to a register value to construct a complete value. 0x800
-    // is added here to compensate for the sign-extension.
-    *(uint32_t *)loc |= (val + 0x800) & 0xffff'f000;
-}
-
-static void write_jtype(uint8_t *loc, uint32_t val)
-{
-    *(uint32_t *)loc &= 0b000000'00000'00000'000'11111'1111111;
-    *(uint32_t *)loc |= nUtil::bit(val, 20) << 31
-                      | nUtil::EPOI(val, 10, 1) << 21 
-                      | nUtil::bit(val, 11) << 20
-                      | nUtil::EPOI(val, 19, 12) << 12;
-}
-
-static void write_citype(uint8_t *loc, uint32_t val)
-{
-    *(uint16_t *)loc &= 0b111'0'11111'00000'11;
-    *(uint16_t *)loc |= bit(val, 5) << 12 | nUtil::EPOI(val, 4, 0) << 2;
-}
-
-static void write_cbtype(uint8_t *loc, uint32_t val)
-{
-    *(uint16_t *)loc &= 0b111'000'111'00000'11;
-    *(uint16_t *)loc |= bit(val, 8) << 12 | bit(val, 4) << 11 | bit(val, 3) << 10 |
-                        bit(val, 7) << 6  | bit(val, 6) << 5  | bit(val, 2) << 4  |
-                        bit(val, 1) << 3  | bit(val, 5) << 2;
-}
 
-static void write_cjtype(uint8_t *loc, uint32_t val)
+// Clear trailing padding of the idx-th member. We write trap or nop instructions for
+// an executable segment so that a disassembler wouldn't try to
+// disassemble garbage as instructions.
+static void Write_trailing_padding(Linking_context &ctx, Output_section &osec, std::size_t idx)
 {
-    *(uint16_t *)loc &= 0b111'00000000000'11;
-    *(uint16_t *)loc |= bit(val, 11) << 12 | bit(val, 4)  << 11 | bit(val, 9) << 10 |
-                        bit(val, 8)  << 9  | bit(val, 10) << 8  | bit(val, 6) << 7  |
-                        bit(val, 7)  << 6  | bit(val, 3)  << 5  | bit(val, 2) << 4  |
-                        bit(val, 1)  << 3  | bit(val, 5)  << 2;
-}
-
-static void set_rs1(uint8_t *loc, uint32_t rs1)
-{
-    assert(rs1 < 32);
-    *(uint32_t *)loc &= 0b111111'11111'00000'111'11111'1111111;
-    *(uint32_t *)loc |= rs1 << 15;
-}
+    auto &isec = *osec.member_list[idx].isec;
+    auto offset = osec.member_list[idx].offset;
 
-static bool is_hi20(const nELF_util::ELF_Rel &rel)
-{
-    auto ty = rel.type();
-    return  ty == (std::size_t)eReloc_type::R_RISCV_GOT_HI20     || ty == (std::size_t)eReloc_type::R_RISCV_TLS_GOT_HI20 ||
-            ty == (std::size_t)eReloc_type::R_RISCV_TLS_GD_HI20  || ty == (std::size_t)eReloc_type::R_RISCV_PCREL_HI20 ||
-            ty == (std::size_t)eReloc_type::R_RISCV_TLSDESC_HI20;
-}
+    uint64_t this_end = offset + isec.size();
+    uint64_t next_start;
+    if (idx + 1 < osec.member_list.size())
+        next_start = osec.member_list[idx + 1].offset;
+    else
+        next_start = osec.shdr.sh_size;
 
-static void Reloc_alloc(Linking_context &ctx, Output_section &osec, std::size_t isec_idx)
-{
-    const Input_section &isec = *osec.member_list[isec_idx].isec;
-    const Input_file &file = *osec.member_list[isec_idx].file;
-    // input section offset from the begining of the file
-    auto isec_file_offset = osec.shdr.sh_offset + osec.member_list[isec_idx].offset;
-    auto isec_addr = osec.shdr.sh_addr + osec.member_list[isec_idx].offset;
-    uint8_t *base = ctx.buf + isec_file_offset;
-
-    auto get_rd = [&](const Input_section &isec, uint64_t offset) -> uint32_t
-    {
-        // Returns the rd register of an R/I/U/J-type instruction.
-        uint32_t instr = *(uint32_t *)(isec.data.data() + offset);
-        return (instr << 20) >> 27;
-    };
+    uint8_t *loc = ctx.buf + osec.shdr.sh_offset + this_end;
+    uint64_t size = next_start - this_end;     
 
-    auto get_sym_addr = [&ctx, isec_addr, &file](Symbol *sym, const Elf64_Sym &esym) -> uint64_t
-    {
-        if (sym && sym->piece())
-            return nLinking_passes::Get_global_symbol_addr(ctx, *sym);
-        else if (nELF_util::Is_sym_local(esym) == true)
-            return isec_addr + sym->elf_sym().st_value ;
-        else if (sym != nullptr)
-            return nLinking_passes::Get_global_symbol_addr(ctx, *sym);
-        else
-            FATALF("why this symbol is not binded?"); 
-    };
+    // 'filler' is a machine-dependant varriable
+    constexpr uint8_t filler[] = { 0x02, 0x90 }; // c.ebreak, risc-v instruction
 
-    for(std::size_t rel_idx = 0 ; rel_idx < isec.rel_count() ; rel_idx++)
+    if (osec.shdr.sh_flags & SHF_EXECINSTR)
     {
-        nELF_util::ELF_Rel rel = isec.rela_at(rel_idx);
-        if (   (eReloc_type)rel.type() == eReloc_type::R_RISCV_NONE 
-            || (eReloc_type)rel.type() == eReloc_type::R_RISCV_RELAX)
-            continue;
-
-        Symbol *sym = file.symbol_list[rel.sym()];
-
-        auto r_offset = rel.offset();
-
-        auto check = [&](int64_t val, int64_t lo, int64_t hi)
-        {
-            if (val < lo || hi <= val)
-                FATALF("%s", "relocation out of range");
-        };
-
-        auto find_paired_reloc = [&]
-        {
-            if (sym->val <= rel.offset())
-            {
-                for (std::size_t j = rel_idx - 1; j < isec.rel_count(); j--)
-                {
-                    if (is_hi20(isec.rela_at(j)) && sym->val == isec.rela_at(j).offset())
-                        return j;
-                }
-            }
-            else
-            {
-                for (std::size_t j = rel_idx + 1; j < isec.rel_count(); j++)
-                {
-                    if (is_hi20(isec.rela_at(j)) && sym->val == isec.rela_at(j).offset())
-                        return j;
-                }
-            }
-            FATALF(": paired relocation is missing: %u", rel_idx);
-        };
-
-        uint8_t *loc = base + r_offset;
-        uint64_t S = get_sym_addr(sym, file.src().symbol_table(rel.sym()));
-        uint64_t A = rel.r_addend;
-        uint64_t P = isec_addr + r_offset;
-        // no linker relaxation supported in current version, so it is set to 0.
-        uint64_t removed_bytes = 0;
-/*         if (   isec.name() == ".text")
-        {
-            std::cout <<std::hex <<rel.type() << " " << rel.offset() << " " << S << " " << A << " " << P << "\n";
-
-        } */
-        switch (rel.type())
-        {
-            case (uint32_t)eReloc_type::R_RISCV_32:
-                new (loc) uint32_t(S + A);
-            break;
-
-            case (uint32_t)eReloc_type::R_RISCV_64:
-                new (loc) uint32_t(S + A);
-            break;
-
-            case (uint32_t)eReloc_type::R_RISCV_BRANCH:
-                check(S + A - P, -(1 << 12), 1 << 12);
-                write_btype(loc, S + A - P);
-            break;
-
-            case (uint32_t)eReloc_type::R_RISCV_JAL:
-                check(S + A - P, -(1 << 20), 1 << 20);
-                write_jtype(loc, S + A - P);
-            break;
-            
-            case (uint32_t)eReloc_type::R_RISCV_CALL:
-            case (uint32_t)eReloc_type::R_RISCV_CALL_PLT:
-            {
-                uint64_t val = S + A - P;
-                uint64_t rd = get_rd(isec, rel.offset() + 4);
-                // Calling an undefined weak symbol does not make sense.
-                // We make such call into an infinite loop. This should
-                // help debugging of a faulty program.
-                if (sym == nullptr && nELF_util::Is_sym_undef_weak(file.src().symbol_table(rel.sym())) == true)
-                    val = 0;
-                check(val, -(1LL << 31), 1LL << 31);
-                write_utype(loc, val);
-                write_itype(loc + 4, val);
-            break;
-            }
-
-            case (uint32_t)eReloc_type::R_RISCV_PCREL_LO12_I:
-            case (uint32_t)eReloc_type::R_RISCV_PCREL_LO12_S:
-            {
-                auto idx2 = find_paired_reloc();
-                const nELF_util::ELF_Rel &rel2 = isec.rela_at(idx2);
-                Symbol *sym2 = file.symbol_list[rel2.sym()];
-
-                uint64_t S = get_sym_addr(sym2, file.src().symbol_table(rel2.sym()));
-                uint64_t A = rel2.r_addend;
-                uint64_t P = isec_addr + rel2.offset();
-                uint64_t val;
-
-                switch (rel2.type())
-                {
-                    case (uint32_t)eReloc_type::R_RISCV_PCREL_HI20:
-                        val = S + A - P;
-                    break;
-
-                    default:
-                        FATALF("non supported link type %u", rel2.type());
-                    break;
-                }
-
-                if (rel.type() == (uint32_t)eReloc_type::R_RISCV_PCREL_LO12_I)
-                    write_itype(loc, val);
-                else
-                    write_stype(loc, val);
-                break;
-            }
-
-
-            case (uint32_t)eReloc_type::R_RISCV_PCREL_HI20:
-                write_utype(loc, S + A - P);
-            break;
-
-            case (uint32_t)eReloc_type::R_RISCV_HI20:
-                check(S + A, -(1LL << 31), 1LL << 31);
-                write_utype(loc, S + A);
-            break;
-
-            case (uint32_t)eReloc_type::R_RISCV_LO12_I:
-            case (uint32_t)eReloc_type::R_RISCV_LO12_S:
-            if (rel.type() == (uint32_t)eReloc_type::R_RISCV_LO12_I)
-                write_itype(loc, S + A);
-            else
-                write_stype(loc, S + A);
-
-            // Rewrite `lw t1, 0(t0)` with `lw t1, 0(x0)` if the address is
-            // accessible relative to the zero register because if that's the
-            // case, corresponding LUI might have been removed by relaxation.
-            if (nUtil::sign_extend(S + A, 11) == S + A)
-                set_rs1(loc, 0);
-            break;
-
-            case (uint32_t)eReloc_type::R_RISCV_ADD8:
-                loc += S + A;
-            break;
-            
-            case (uint32_t)eReloc_type::R_RISCV_ADD16:
-                *(uint16_t*)loc += S + A;
-            break;
-            
-            case (uint32_t)eReloc_type::R_RISCV_ADD32:
-                *(uint32_t*)loc += S + A;
-            break;
-            
-            case (uint32_t)eReloc_type::R_RISCV_ADD64:
-                *(uint64_t*)loc += S + A;
-            break;
-            
-            case (uint32_t)eReloc_type::R_RISCV_SUB8:
-                loc -= S + A;
-            break;
-            
-            case (uint32_t)eReloc_type::R_RISCV_SUB16:
-                *(uint16_t*)loc -= S + A;
-            break;
-            
-            case (uint32_t)eReloc_type::R_RISCV_SUB32:
-                *(uint32_t*)loc -= S + A;
-            break;
-            
-            case (uint32_t)eReloc_type::R_RISCV_SUB64:
-                *(uint64_t*)loc -= S + A;
-            break;
-
-            case (uint32_t)eReloc_type::R_RISCV_ALIGN:
-            {
-                // A R_RISCV_ALIGN is followed by a NOP sequence. We need to remove
-                // zero or more bytes so that the instruction after R_RISCV_ALIGN is
-                // aligned to a given alignment boundary.
-                //
-                // We need to guarantee that the NOP sequence is valid after byte
-                // removal (e.g. we can't remove the first 2 bytes of a 4-byte NOP).
-                // For the sake of simplicity, we always rewrite the entire NOP sequence.
-                
-                int64_t padding_bytes = rel.r_addend - removed_bytes;
-                assert((padding_bytes & 1) == 0);
-
-                int64_t i = 0;
-                for (; i <= padding_bytes - 4; i += 4)
-                    *(uint32_t *)(loc + i) = 0x0000'0013; // nop
-                if (i < padding_bytes)
-                    *(uint16_t *)(loc + i) = 0x0001;      // c.nop
-                break;
-            }
-
-            case (uint32_t)eReloc_type::R_RISCV_RVC_BRANCH:
-                check(S + A - P, -(1 << 8), 1 << 8);
-                write_cbtype(loc, S + A - P);
-            break;
-
-            case (uint32_t)eReloc_type::R_RISCV_RVC_JUMP:
-                check(S + A - P, -(1 << 11), 1 << 11);
-                write_cjtype(loc, S + A - P);
-            break;
-
-            case (uint32_t)eReloc_type::R_RISCV_SUB6:
-                *loc = (*loc & 0b1100'0000) | ((*loc - S - A) & 0b0011'1111);
-            break;
-
-            case (uint32_t)eReloc_type::R_RISCV_SET6:
-                *loc = (*loc & 0b1100'0000) | ((S + A) & 0b0011'1111);
-            break;
-
-            case(uint32_t)eReloc_type:: R_RISCV_SET8:
-                *loc = S + A;
-            break;
-
-            case (uint32_t)eReloc_type::R_RISCV_SET16:
-                *(uint16_t*)loc = S + A;
-            break;
-
-            case (uint32_t)eReloc_type::R_RISCV_SET32:
-                *(uint32_t*)loc = S + A;
-            break;
-
-            case (uint32_t)eReloc_type::R_RISCV_PLT32:
-            case (uint32_t)eReloc_type::R_RISCV_32_PCREL:
-                *(uint32_t*)loc = S + A - P;
-            break;
-            
-            case (uint32_t)eReloc_type::R_RISCV_SET_ULEB128:
-                nUtil::Overwrite_uleb(loc, S + A);
-            break;
-            
-            case (uint32_t)eReloc_type::R_RISCV_SUB_ULEB128:
-                nUtil::Overwrite_uleb(loc, nUtil::read_uleb(loc) - S - A);
-            break;
-            
-            default:
-                FATALF("non supported link type %u", rel.type());
-            break;
-        }
+        for (uint64_t i = 0; i + sizeof(filler) <= size; i += sizeof(filler))
+            memcpy(loc + i, filler, sizeof(filler));
     }
-
-}
-static void Reloc_non_alloc(Linking_context &ctx, Output_section &osec, std::size_t isec_idx)
-{
-    Reloc_alloc(ctx, osec, isec_idx); // TODO, use better implementation
+    else
+        memset(loc, 0, size);
 }
 
+// Each input section is copied, relocated and followed by its trailing padding
+// before moving on to the next one, so its data is touched while it's in the cache.
 void nLinking_passes::Relocate_symbols(Linking_context &ctx, Output_section &osec)
 {
-    for(std::size_t i = 0 ; i < osec.member_list.size() ; i++)
+    // input sections are written to disjoint ranges of the output buffer, so they are relocated in parallel
+    nUtil::Parallel_for(osec.member_list.size(), [&](std::size_t i)
     {
-        memcpy(ctx.buf + osec.shdr.sh_offset + osec.member_list[i].offset, 
-               osec.member_list[i].isec->data.data(),
-               osec.member_list[i].isec->data.size());
-
         if (osec.member_list[i].isec->shdr().sh_flags & SHF_ALLOC)
-            Reloc_alloc(ctx, osec, i);
+            nRelocation::Reloc_alloc(ctx, osec, i);
         else
-            Reloc_non_alloc(ctx, osec, i);
-    }
-}
\ No newline at end of file
+            nRelocation::Reloc_non_alloc(ctx, osec, i);
+
+        Write_trailing_padding(ctx, osec, i);
+
+        // thunks are in the padding after the last member of a batch
+        if (const Output_section::Thunk_batch *batch = osec.Get_thunk_batch(i) ; batch != nullptr && batch->last_member_idx == i)
+            nRelocation::Write_thunks(ctx, osec, *batch);
+    });
+}
@@ -50,7 +50,7 @@ void Merged_section::Assign_offset()
         if (piece->is_alive == false)
             continue;
 
-        offset = nUtil::align_to(offset, 1 << p2align);
+        offset = nUtil::align_to(offset, 1 << piece->p2align);
         piece->offset = offset;
         offset += item.first.size();
         p2align = std::max(p2align, piece->p2align);
@@ -109,7 +109,7 @@ static std::vector<Elf64_phdr_t> Create_phdrs(Linking_context &ctx)
         Output_chunk *first = *(std::prev(it));
         std::size_t flags = to_phdr_flags(ctx, first->chunk());
         append_segment(PT_LOAD, flags, &first->chunk());
-        vec.back().p_align = std::max<uint64_t>(ctx.page_size, vec.back().p_align);
+        vec.back().p_align = std::max<uint64_t>(nLinking_context_helper::Get_segment_alignment(ctx, first->chunk()), vec.back().p_align);
 
         // Add contiguous ALLOC sections as long as they have the same
         // section flags and there's no on-disk gap in between.
@@ -329,38 +329,6 @@ Output_chunk::Output_chunk<Output_section>(Output_section *osec, Linking_context
             return;
 
         nLinking_passes::Relocate_symbols(ctx, *output_section);
-
-        uint8_t *osec_data = ctx.buf + output_section->shdr.sh_offset;
-
-        for(std::size_t i = 0 ; i < output_section->member_list.size() ; i++)
-        {
-            auto &isec = *output_section->member_list[i].isec;
-            auto offset = output_section->member_list[i].offset;
-            
-            // Clear trailing padding. We write trap or nop instructions for
-            // an executable segment so that a disassembler wouldn't try to
-            // disassemble garbage as instructions.
-            uint64_t this_end = offset + isec.shdr().sh_size;
-            uint64_t next_start;
-            if (i + 1 < output_section->member_list.size())
-                next_start = output_section->member_list[i + 1].offset;
-            else
-                next_start = output_section->shdr.sh_size;
-
-            uint8_t *loc = osec_data + this_end;
-            uint64_t size = next_start - this_end;     
-
-            // 'filler' is a machine-dependant varriable
-            constexpr uint8_t filler[] = { 0x02, 0x90 }; // c.ebreak, risc-v instruction
-
-            if (output_section->shdr.sh_flags & SHF_EXECINSTR)
-            {
-                for (uint64_t i = 0; i + sizeof(filler) <= size; i += sizeof(filler))
-                    memcpy(loc + i, filler, sizeof(filler));
-            }
-            else
-                memset(loc, 0, size);
-        }
     };// m_copy_chunk
 }
 
@@ -375,6 +343,9 @@ Output_chunk::Output_chunk<Merged_section>(Merged_section *msec, Linking_context
         uint8_t *buf = ctx.buf + msec->shdr.sh_offset;
 
         auto vec = msec->Get_ordered_span();
+
+        // the end of the last alive piece, dead pieces have no offset
+        uint64_t end = 0;
         for(std::size_t i = 0 ; i < vec.size() ; i++)
         {
             if (vec[i].second->is_alive == false)
@@ -382,14 +353,11 @@ Output_chunk::Output_chunk<Merged_section>(Merged_section *msec, Linking_context
 
             // There might be gaps between strings to satisfy alignment requirements.
             // If that's the case, we need to zero-clear them.    
-            if (i + 1 != vec.size())
-            {
-                memset(buf + vec[i].second->offset + vec[i].first.length(), 
-                       0, 
-                       vec[i+1].second->offset - vec[i].second->offset - vec[i].first.length());
-            }
+            memset(buf + end, 0, vec[i].second->offset - end);
+
             assert(msec->shdr.sh_offset + vec[i].second->offset + vec[i].first.length() <= ctx.filesize);
             memcpy(buf + vec[i].second->offset, vec[i].first.data(), vec[i].first.length());
+            end = vec[i].second->offset + vec[i].first.length();
         }
         
     };
@@ -424,4 +392,52 @@ template<>
 Output_chunk::Output_chunk<Symtab_shndx_section>(Symtab_shndx_section *sec, Linking_context &ctx):m_chunk(sec), m_ctx(&ctx)
 {
     
-}
\ No newline at end of file
+}
+
+void Got_section::Add_symbol(Symbol &sym, const Input_file &file)
+{
+    if (sym.got_idx != -1)
+        return;
+
+    sym.got_idx = entry_list.size();
+    entry_list.push_back(Entry{&sym, &file});
+    this->shdr.sh_size = entry_list.size() * sizeof(Elf64_Addr);
+}
+
+uint64_t Got_section::Get_slot_addr(const Symbol &sym) const
+{
+    assert(sym.got_idx != -1);
+    return this->shdr.sh_addr + sym.got_idx * sizeof(Elf64_Addr);
+}
+
+template<>
+Output_chunk::Output_chunk<Got_section>(Got_section *got, Linking_context &ctx):m_chunk(got), m_ctx(&ctx)
+{
+    m_copy_chunk = [](Chunk *_got, Linking_context &ctx)
+    {
+        auto *got = (Got_section*)_got;
+        auto *buf = (Elf64_Addr*)(ctx.buf + got->shdr.sh_offset);
+
+        // a static executable is not relocated at runtime, so GOT slots are filled with symbol addresses
+        for(std::size_t i = 0 ; i < got->entry_list.size() ; i++)
+            buf[i] = nLinking_passes::Get_symbol_addr(ctx, *got->entry_list[i].file, *got->entry_list[i].sym);
+    };
+}
+
+template<>
+Output_chunk::Output_chunk<Jvt_section>(Jvt_section *jvt, Linking_context &ctx):m_chunk(jvt), m_ctx(&ctx)
+{
+    m_copy_chunk = [](Chunk *_jvt, Linking_context &ctx)
+    {
+        auto *jvt = (Jvt_section*)_jvt;
+        auto *buf = (Elf64_Addr*)(ctx.buf + jvt->shdr.sh_offset);
+
+        for(std::size_t i = 0 ; i < jvt->entry_list.size() ; i++)
+        {
+            if (jvt->entry_list[i].sym == nullptr)
+                buf[i] = 0;
+            else
+                buf[i] = nLinking_passes::Get_symbol_addr(ctx, *jvt->entry_list[i].file, *jvt->entry_list[i].sym);
+        }
+    };
+}
@@ -0,0 +1,1343 @@
+#include <array>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+#include "Relocation.h"
+#include "Linking_passes.h"
+#include "ELF_util.h"
+
+using nUtil::bit;
+// a lot of code is copied from https://github.com/rui314/mold
+
+static void write_itype(uint8_t *loc, uint32_t val)
+{
+    *(uint32_t *)loc &= 0b000000'00000'11111'111'11111'1111111;
+    *(uint32_t *)loc |= nUtil::EPOI(val, 11, 0) << 20;
+}
+
+static void write_stype(uint8_t *loc, uint32_t val)
+{
+    *(uint32_t *)loc &= 0b000000'11111'11111'111'00000'1111111;
+    *(uint32_t *)loc |= nUtil::EPOI(val, 11, 5) << 25 
+                    | nUtil::EPOI(val, 4, 0) << 7;
+}
+
+static void write_btype(uint8_t *loc, uint32_t val)
+{
+    *(uint32_t *)loc &= 0b000000'11111'11111'111'00000'1111111;
+    *(uint32_t *)loc |= nUtil::bit(val, 12) << 31 
+                    | nUtil::EPOI(val, 10, 5) << 25 
+                    | nUtil::EPOI(val, 4, 1) << 8
+                    | nUtil::bit(val, 11) << 7;
+}
+
+static void write_utype(uint8_t *loc, uint32_t val)
+{
+    *(uint32_t *)loc &= 0b000000'00000'00000'000'11111'1111111;
+
+    // U-type instructions are used in combination with I-type
+    // instructions. U-type insn sets an immediate to the upper 20-bits
+    // of a register. I-type insn sign-extends a 12-bits immediate and
+    // adds it to a register value to construct a complete value. 0x800
+    // is added here to compensate for the sign-extension.
+    *(uint32_t *)loc |= (val + 0x800) & 0xffff'f000;
+}
+
+static void write_jtype(uint8_t *loc, uint32_t val)
+{
+    *(uint32_t *)loc &= 0b000000'00000'00000'000'11111'1111111;
+    *(uint32_t *)loc |= nUtil::bit(val, 20) << 31
+                      | nUtil::EPOI(val, 10, 1) << 21 
+                      | nUtil::bit(val, 11) << 20
+                      | nUtil::EPOI(val, 19, 12) << 12;
+}
+
+static void write_citype(uint8_t *loc, uint32_t val)
+{
+    *(uint16_t *)loc &= 0b111'0'11111'00000'11;
+    *(uint16_t *)loc |= bit(val, 5) << 12 | nUtil::EPOI(val, 4, 0) << 2;
+}
+
+static void write_cbtype(uint8_t *loc, uint32_t val)
+{
+    *(uint16_t *)loc &= 0b111'000'111'00000'11;
+    *(uint16_t *)loc |= bit(val, 8) << 12 | bit(val, 4) << 11 | bit(val, 3) << 10 |
+                        bit(val, 7) << 6  | bit(val, 6) << 5  | bit(val, 2) << 4  |
+                        bit(val, 1) << 3  | bit(val, 5) << 2;
+}
+
+static void write_cjtype(uint8_t *loc, uint32_t val)
+{
+    *(uint16_t *)loc &= 0b111'00000000000'11;
+    *(uint16_t *)loc |= bit(val, 11) << 12 | bit(val, 4)  << 11 | bit(val, 9) << 10 |
+                        bit(val, 8)  << 9  | bit(val, 10) << 8  | bit(val, 6) << 7  |
+                        bit(val, 7)  << 6  | bit(val, 3)  << 5  | bit(val, 2) << 4  |
+                        bit(val, 1)  << 3  | bit(val, 5)  << 2;
+}
+
+static void set_rs1(uint8_t *loc, uint32_t rs1)
+{
+    assert(rs1 < 32);
+    *(uint32_t *)loc &= 0b111111'11111'00000'111'11111'1111111;
+    *(uint32_t *)loc |= rs1 << 15;
+}
+
+static bool is_hi20(const nELF_util::ELF_Rel &rel)
+{
+    auto ty = rel.type();
+    return  ty == (std::size_t)eReloc_type::R_RISCV_GOT_HI20     || ty == (std::size_t)eReloc_type::R_RISCV_TLS_GOT_HI20 ||
+            ty == (std::size_t)eReloc_type::R_RISCV_TLS_GD_HI20  || ty == (std::size_t)eReloc_type::R_RISCV_PCREL_HI20 ||
+            ty == (std::size_t)eReloc_type::R_RISCV_TLSDESC_HI20;
+}
+
+// PCREL_LO12_I/S relocations do not point to the real target, they point to
+// the label of their paired HI20 relocation. Relocations are sorted by r_offset,
+// so HI20 relocations are collected once per input section and looked up by
+// binary search. S + A - P of a HI20 is computed once and shared by all the
+// LO12 relocations which refer to it.
+struct Hi20_index
+{
+    Hi20_index() = default;
+    
+    Hi20_index(const Input_section &isec)
+    {
+        for(std::size_t rel_idx = 0 ; rel_idx < isec.rel_count() ; rel_idx++)
+        {
+            nELF_util::ELF_Rel rel = isec.rela_at(rel_idx);
+            if (is_hi20(rel) == false)
+                continue;
+            
+            offset_list.push_back(rel.offset());
+            rel_idx_list.push_back(rel_idx);
+        }
+
+        value_list.resize(rel_idx_list.size());
+        is_cached.resize(rel_idx_list.size(), false);
+    }
+
+    // return the position of the HI20 relocation at 'offset' in this index, or -1 if it is missing
+    std::size_t Find(uint64_t offset) const
+    {
+        auto it = std::lower_bound(offset_list.begin(), offset_list.end(), offset);
+        
+        if (it == offset_list.end() || *it != offset)
+            return -1;
+        
+        return it - offset_list.begin();
+    }
+
+    std::vector<uint64_t> offset_list;
+    std::vector<std::size_t> rel_idx_list;
+    std::vector<uint64_t> value_list;
+    std::vector<bool> is_cached;
+};
+
+// everything a relocation kernel needs to know about the input section being relocated
+struct Reloc_state
+{
+    Reloc_state(Linking_context &ctx, const Output_section &osec, std::size_t isec_idx)
+              : ctx(ctx),
+                osec(osec),
+                isec_idx(isec_idx),
+                isec(*osec.member_list[isec_idx].isec),
+                file(*osec.member_list[isec_idx].file),
+                isec_addr(osec.shdr.sh_addr + osec.member_list[isec_idx].offset),
+                // there is no output buffer yet while sections are relaxed
+                base(ctx.buf ? ctx.buf + osec.shdr.sh_offset + osec.member_list[isec_idx].offset : nullptr),
+                gp(ctx.link_option_args().relax ? ctx.special_symbols.global_pointer->val : 0),
+                tp(ctx.tp_addr){}
+
+    // S, the address of the symbol referred by 'rel'
+    uint64_t Get_sym_addr(const nELF_util::ELF_Rel &rel) const;
+
+    // S of a relocation of a non-alloc section, the symbol of a discarded section is at 0
+    uint64_t Get_non_alloc_sym_addr(const nELF_util::ELF_Rel &rel);
+
+    // the value of the HI20 relocation at position 'pos' of 'hi20_index', S + A - P for PCREL_HI20 
+    // and S + A - TP for TLS relocations which are relaxed to local-exec
+    uint64_t Get_hi20_val(std::size_t pos);
+
+    // position of the HI20 relocation which the LO12 relocation 'rel' is paired with in 'hi20_index'
+    std::size_t Find_paired_hi20(const nELF_util::ELF_Rel &rel) const;
+
+    // true if the instruction of the relocation at 'rel_idx' is rewritten for the relaxed sequence it belongs to
+    bool Is_rewritten(std::size_t rel_idx) const
+    {
+        return std::binary_search(isec.rewritten_rel_list.begin(), isec.rewritten_rel_list.end(), rel_idx);
+    }
+
+    // true if 'val' can be accessed by a signed 12-bit offset from the zero register or gp, 
+    // and the base register is set to 'rs1'
+    bool Is_short_addr(int64_t val, uint32_t *rs1) const
+    {
+        if (nUtil::sign_extend(val, 11) == val)
+        {
+            *rs1 = 0;
+            return true;
+        }
+
+        if (gp != 0 && nUtil::sign_extend(val - gp, 11) == (int64_t)(val - gp))
+        {
+            *rs1 = 3; // gp is x3
+            return true;
+        }
+
+        return false;
+    }
+
+    // where 'offset' of the input section is placed after linker relaxation, 
+    // 'rel_idx' is the first relocation at or after 'offset'
+    uint64_t Get_out_offset(std::size_t rel_idx, uint64_t offset) const
+    {
+        return isec.r_deltas.empty() ? offset : offset - isec.r_deltas[rel_idx];
+    }
+
+    // bytes removed by linker relaxation at the 'rel_idx'-th relocation
+    uint64_t Get_removed_bytes(std::size_t rel_idx) const
+    {
+        return isec.r_deltas.empty() ? 0 : isec.r_deltas[rel_idx + 1] - isec.r_deltas[rel_idx];
+    }
+
+    // the rd register of an R/I/U/J-type instruction of the input section
+    uint32_t Get_rd(uint64_t offset) const
+    {
+        uint32_t instr = *(uint32_t *)(isec.data.data() + offset);
+        return (instr << 20) >> 27;
+    }
+
+    Linking_context &ctx;
+    const Output_section &osec;
+    std::size_t isec_idx;
+    const Input_section &isec;
+    const Input_file &file;
+    uint64_t isec_addr;
+    // where the input section is copied in the output buffer
+    uint8_t *base;
+    // __global_pointer$, or 0 if gp relative accesses are not allowed
+    uint64_t gp;
+    uint64_t tp;
+    // only built for alloc sections, debug sections have no HI20/LO12 pairs
+    Hi20_index hi20_index;
+    // buffer for grouping relocations by type
+    std::vector<uint32_t> order;
+    // the last symbol looked up by Get_non_alloc_sym_addr, a debug section 
+    // usually refers the same section symbol many times in a row
+    std::size_t last_sym_idx = -1;
+    uint64_t last_sym_addr = 0;
+};
+
+inline uint64_t Reloc_state::Get_sym_addr(const nELF_util::ELF_Rel &rel) const
+{
+    Symbol *sym = file.symbol_list[rel.sym()];
+
+    if (sym == nullptr)
+        FATALF("%s", "why this symbol is not binded?");
+
+    return nLinking_passes::Get_symbol_addr(ctx, file, *sym);
+}
+
+uint64_t Reloc_state::Get_non_alloc_sym_addr(const nELF_util::ELF_Rel &rel)
+{
+    if (rel.sym() == last_sym_idx)
+        return last_sym_addr;
+
+    Symbol *sym = file.symbol_list[rel.sym()];
+
+    if (sym == nullptr)
+        FATALF("%s", "why this symbol is not binded?");
+
+    if (sym->piece() != nullptr || nELF_util::Is_sym_local(sym->elf_sym()) == false)
+    {
+        last_sym_addr = nLinking_passes::Get_global_symbol_addr(ctx, *sym);
+    }
+    else
+    {
+        const Input_section *target = file.Get_input_section(file.src().get_shndx(sym->elf_sym()));
+
+        if (target == nullptr)
+            last_sym_addr = sym->val; // absolute symbol
+        else if (target->osec == nullptr && target->leader == nullptr)
+            last_sym_addr = 0; // debug info of a section which is not in the output
+        else
+            last_sym_addr = nLinking_passes::Get_input_section_addr(ctx, target, sym->val);
+    }
+
+    last_sym_idx = rel.sym();
+    return last_sym_addr;
+}
+
+uint64_t Reloc_state::Get_hi20_val(std::size_t pos)
+{
+    if (hi20_index.is_cached[pos] == true)
+        return hi20_index.value_list[pos];
+
+    std::size_t rel_idx = hi20_index.rel_idx_list[pos];
+    nELF_util::ELF_Rel rel2 = isec.rela_at(rel_idx);
+
+    uint64_t A = rel2.r_addend;
+    uint64_t P = isec_addr + Get_out_offset(rel_idx, rel2.offset());
+
+    switch (rel2.type())
+    {
+        case (uint32_t)eReloc_type::R_RISCV_PCREL_HI20:
+            hi20_index.value_list[pos] = Get_sym_addr(rel2) + A - P;
+        break;
+
+        // G + GOT + A - P, or S + A - P if the GOT load is relaxed
+        case (uint32_t)eReloc_type::R_RISCV_GOT_HI20:
+            if (nRelocation::Is_got_relaxable(ctx, file, isec, rel_idx) == true)
+                hi20_index.value_list[pos] = Get_sym_addr(rel2) + A - P;
+            else
+                hi20_index.value_list[pos] = ctx.got->Get_slot_addr(*file.symbol_list[rel2.sym()]) + A - P;
+        break;
+
+        // the output is always a static executable, 
+        // so TLS general-dynamic, initial-exec and TLSDESC are relaxed to local-exec
+        case (uint32_t)eReloc_type::R_RISCV_TLS_GD_HI20:
+        case (uint32_t)eReloc_type::R_RISCV_TLS_GOT_HI20:
+        case (uint32_t)eReloc_type::R_RISCV_TLSDESC_HI20:
+            hi20_index.value_list[pos] = Get_sym_addr(rel2) + A - tp;
+        break;
+
+        default:
+            FATALF("non supported link type %lu", rel2.type());
+        break;
+    }
+
+    hi20_index.is_cached[pos] = true;
+    return hi20_index.value_list[pos];
+}
+
+bool nRelocation::Is_got_relaxable(const Linking_context &ctx, const Input_file &file, const Input_section &isec, std::size_t rel_idx)
+{
+    // In a static executable, a symbol defined in the output is at a fixed address
+    // which is PC relative reachable, so `auipc + ld` of its GOT slot can be 
+    // `auipc + addi` of the symbol address. Absolute symbols might be out of the range.
+    if (   ctx.link_option_args().relax == false
+        || rel_idx + 1 == isec.rel_count()
+        || isec.rela_at(rel_idx + 1).type() != (std::size_t)eReloc_type::R_RISCV_RELAX)
+        return false;
+
+    const Symbol *sym = file.symbol_list[isec.rela_at(rel_idx).sym()];
+
+    return    sym != nullptr
+           && nELF_util::Is_sym_undef(sym->elf_sym()) == false
+           && (sym->piece() != nullptr || nELF_util::Is_sym_abs(sym->elf_sym()) == false);
+}
+
+Symbol* nRelocation::Get_table_jump_target(const Linking_context &ctx, const Input_file &file, const Input_section &isec, std::size_t rel_idx, bool *is_link)
+{
+    nELF_util::ELF_Rel rel = isec.rela_at(rel_idx);
+
+    if (   (rel.type() != (std::size_t)eReloc_type::R_RISCV_CALL && rel.type() != (std::size_t)eReloc_type::R_RISCV_CALL_PLT)
+        || rel_idx + 1 == isec.rel_count()
+        || isec.rela_at(rel_idx + 1).type() != (std::size_t)eReloc_type::R_RISCV_RELAX
+        || rel.r_addend != 0)
+        return nullptr;
+
+    Symbol *sym = file.symbol_list[rel.sym()];
+
+    // the same symbols as the ones which are relaxed to jal
+    if (   sym == nullptr 
+        || (sym->piece() == nullptr && nELF_util::Is_sym_abs(sym->elf_sym()))
+        || nELF_util::Is_sym_undef(sym->elf_sym())
+        || sym == ctx.special_symbols.tls_get_addr)
+        return nullptr;
+
+    // rd of the jalr, cm.jt doesn't link, cm.jalt links ra
+    uint32_t rd = ((*(uint32_t *)(isec.data.data() + rel.offset() + 4)) << 20) >> 27;
+
+    if (rd != 0 && rd != 1)
+        return nullptr;
+
+    *is_link = (rd == 1);
+    return sym;
+}
+
+// index of the table jump entry of the call 'rel', -1 if it's not called by a table jump
+static int32_t Get_table_jump_index(const Reloc_state &state, const nELF_util::ELF_Rel &rel, uint32_t rd)
+{
+    if (state.ctx.jvt == nullptr || (rd != 0 && rd != 1) || rel.r_addend != 0)
+        return -1;
+
+    Symbol *sym = state.file.symbol_list[rel.sym()];
+    if (sym == nullptr)
+        return -1;
+
+    return state.ctx.jvt->Get_index(*sym, rd == 1);
+}
+
+std::size_t Reloc_state::Find_paired_hi20(const nELF_util::ELF_Rel &rel) const
+{
+    // the symbol of a LO12 relocation is the label of its paired HI20 relocation 
+    Symbol *sym = file.symbol_list[rel.sym()];
+    std::size_t pos = hi20_index.Find(sym->val);
+
+    if (pos == (std::size_t)-1)
+        FATALF(": paired relocation is missing: %lu", rel.offset());
+
+    return pos;
+}
+
+// __tls_get_addr is called by TLS general-dynamic sequences, which are relaxed to local-exec 
+// in a static executable, the other calls of it are kept as they are
+static bool Is_tls_get_addr(const Reloc_state &state, const nELF_util::ELF_Rel &rel)
+{
+    const Symbol *sym = state.file.symbol_list[rel.sym()];
+    return sym != nullptr && sym == state.ctx.special_symbols.tls_get_addr;
+}
+
+static void Check_range(int64_t val, int64_t lo, int64_t hi)
+{
+    if (val < lo || hi <= val)
+        FATALF("%s", "relocation out of range");
+}
+
+static bool Is_jal_reachable(int64_t val)
+{
+    return -(1 << 20) <= val && val < (1 << 20);
+}
+
+// S + A - P of a jump which is a JAL in the output, if the target is out of the range of JAL, 
+// it's the distance to the range extension thunk of the target instead
+static int64_t Get_jal_val(const Reloc_state &state, const nELF_util::ELF_Rel &rel, uint64_t P)
+{
+    int64_t val = state.Get_sym_addr(rel) + rel.r_addend - P;
+
+    if (Is_jal_reachable(val) == true || rel.r_addend != 0)
+        return val;
+
+    const Output_section::Thunk_batch *batch = state.osec.Get_thunk_batch(state.isec_idx);
+    if (batch == nullptr)
+        return val;
+
+    auto it = batch->index_map.find(state.file.symbol_list[rel.sym()]);
+    if (it == batch->index_map.end())
+        return val;
+
+    return state.osec.shdr.sh_addr + batch->offset + it->second * Output_section::gTHUNK_SIZE - P;
+}
+
+void nRelocation::Scan_thunk_targets(Linking_context &ctx, const Output_section &osec, std::size_t isec_idx, std::vector<Output_section::Thunk_batch::Entry> &target_list)
+{
+    using T = eReloc_type;
+
+    Reloc_state state(ctx, osec, isec_idx);
+    const Input_section &isec = state.isec;
+
+    for(std::size_t i = 0 ; i < isec.rel_count() ; i++)
+    {
+        nELF_util::ELF_Rel rel = isec.rela_at(i);
+
+        // a CALL relaxed to JAL, thunks are not used for C.J and table jumps, which remove 6 bytes
+        bool is_jal =    rel.type() == (std::size_t)T::R_RISCV_JAL
+                      || (   (rel.type() == (std::size_t)T::R_RISCV_CALL || rel.type() == (std::size_t)T::R_RISCV_CALL_PLT)
+                          && state.Get_removed_bytes(i) == 4
+                          && state.Is_rewritten(i) == false);
+
+        if (is_jal == false || rel.r_addend != 0)
+            continue;
+
+        Symbol *sym = state.file.symbol_list[rel.sym()];
+        if (sym == nullptr || nELF_util::Is_sym_undef(sym->elf_sym()))
+            continue;
+
+        int64_t val = state.Get_sym_addr(rel) - (state.isec_addr + state.Get_out_offset(i, rel.offset()));
+
+        if (Is_jal_reachable(val) == false)
+            target_list.push_back(Output_section::Thunk_batch::Entry{sym, &state.file});
+    }
+}
+
+void nRelocation::Write_thunks(Linking_context &ctx, const Output_section &osec, const Output_section::Thunk_batch &batch)
+{
+    uint8_t *base = ctx.buf + osec.shdr.sh_offset + batch.offset;
+    uint64_t addr = osec.shdr.sh_addr + batch.offset;
+
+    for(std::size_t i = 0 ; i < batch.entry_list.size() ; i++)
+    {
+        uint8_t *loc = base + i * Output_section::gTHUNK_SIZE;
+        uint64_t P = addr + i * Output_section::gTHUNK_SIZE;
+        int64_t val = nLinking_passes::Get_symbol_addr(ctx, *batch.entry_list[i].file, *batch.entry_list[i].sym) - P;
+
+        // t1 is a temporary register which is not preserved across calls
+        *(uint32_t *)loc = 0x0000'0317;       // auipc t1, <hi20>
+        *(uint32_t *)(loc + 4) = 0x0003'0067; // jalr  zero, <lo12>(t1)
+        Check_range(val, -(1LL << 31), 1LL << 31);
+        write_utype(loc, val);
+        write_itype(loc + 4, val);
+    }
+}
+
+template<eReloc_type>
+constexpr bool gDEPENDENT_FALSE = false;
+
+// Apply one relocation, each relocation type gets its own instantiation
+// so that there is no switch on the relocation type in a kernel.
+template<eReloc_type type>
+static inline void Apply_reloc(Reloc_state &state, std::size_t rel_idx, const nELF_util::ELF_Rel &rel)
+{
+    using T = eReloc_type;
+    
+    uint64_t removed_bytes = state.Get_removed_bytes(rel_idx);
+    uint64_t out_offset = state.Get_out_offset(rel_idx, rel.offset());
+    
+    uint8_t *loc = state.base + out_offset;
+    uint64_t A = rel.r_addend;
+    uint64_t P = state.isec_addr + out_offset;
+
+    // R_RISCV_32 and R_RISCV_64 are applied by Data_reloc_kernel
+    if constexpr (type == T::R_RISCV_BRANCH)
+    {
+        int64_t val = state.Get_sym_addr(rel) + A - P;
+
+        // thunks are only created for JAL, a conditional branch has no way to reach further
+        if (val < -(1 << 12) || (1 << 12) <= val)
+            FATALF("conditional branch at %.*s+0x%lx is out of range, %ld bytes away from its target, no thunk is created for it", 
+                   (int)state.isec.name().size(), state.isec.name().data(), rel.offset(), val);
+        write_btype(loc, val);
+    }
+    else if constexpr (type == T::R_RISCV_JAL)
+    {
+        int64_t val = Get_jal_val(state, rel, P);
+        Check_range(val, -(1 << 20), 1 << 20);
+        write_jtype(loc, val);
+    }
+    else if constexpr (type == T::R_RISCV_CALL || type == T::R_RISCV_CALL_PLT)
+    {
+        if (state.Is_rewritten(rel_idx) == true)
+        {
+            // call __tls_get_addr of a general-dynamic sequence -> add a0, a0, tp
+            *(uint32_t *)loc = 0x0045'0533;
+            if (removed_bytes == 0)
+                *(uint32_t *)(loc + 4) = 0x0000'0013; // nop
+            return;
+        }
+
+        uint64_t val = state.Get_sym_addr(rel) + A - P;
+        uint32_t rd = state.Get_rd(rel.offset() + 4);
+        int32_t table_idx;
+
+        if (removed_bytes == 6 && (table_idx = Get_table_jump_index(state, rel, rd)) != -1)
+        {
+            // auipc + jalr -> cm.jt or cm.jalt, the index tells which one it is
+            *(uint16_t *)loc = 0b101'000'00000000'10 | (table_idx << 2);
+        }
+        else if (removed_bytes == 4)
+        {
+            // auipc + jalr -> jal, the layout might be changed by thunks after it's relaxed
+            val = Get_jal_val(state, rel, P);
+            *(uint32_t *)loc = (rd << 7) | 0b1101111;
+            Check_range(val, -(1 << 20), 1 << 20);
+            write_jtype(loc, val);
+        }
+        else if (removed_bytes == 6 && rd == 0)
+        {
+            // auipc + jalr -> c.j
+            *(uint16_t *)loc = 0b101'00000000000'01;
+            Check_range(val, -(1 << 11), 1 << 11);
+            write_cjtype(loc, val);
+        }
+        else
+        {
+            assert(removed_bytes == 0);
+            Check_range(val, -(1LL << 31), 1LL << 31);
+            write_utype(loc, val);
+            write_itype(loc + 4, val);
+        }
+    }
+    else if constexpr (type == T::R_RISCV_PCREL_LO12_I || type == T::R_RISCV_PCREL_LO12_S)
+    {
+        std::size_t pos = state.Find_paired_hi20(rel);
+        uint64_t val = state.Get_hi20_val(pos);
+
+        if constexpr (type == T::R_RISCV_PCREL_LO12_I)
+        {
+            // initial-exec and relaxed GOT loads: ld rd, <lo12>(rs1) -> addi rd, rs1, <lo12>
+            std::size_t hi20_rel_idx = state.hi20_index.rel_idx_list[pos];
+            std::size_t hi20_type = state.isec.rela_at(hi20_rel_idx).type();
+
+            if (   hi20_type == (std::size_t)T::R_RISCV_TLS_GOT_HI20 
+                || (   hi20_type == (std::size_t)T::R_RISCV_GOT_HI20 
+                    && nRelocation::Is_got_relaxable(state.ctx, state.file, state.isec, hi20_rel_idx) == true))
+                *(uint32_t *)loc = (*(uint32_t *)loc & 0b00000'00000'11111'000'11111'0000000) | 0b0010011;
+
+            write_itype(loc, val);
+        }
+        else
+            write_stype(loc, val);
+    }
+    else if constexpr (type == T::R_RISCV_PCREL_HI20 || type == T::R_RISCV_GOT_HI20)
+    {
+        write_utype(loc, state.Get_hi20_val(state.hi20_index.Find(rel.offset())));
+    }
+    else if constexpr (type == T::R_RISCV_TLS_GD_HI20 || type == T::R_RISCV_TLS_GOT_HI20)
+    {
+        // general-dynamic and initial-exec: auipc rd, <hi20> -> lui rd, <tprel hi20>
+        *(uint32_t *)loc = (state.Get_rd(rel.offset()) << 7) | 0b0110111;
+        write_utype(loc, state.Get_hi20_val(state.hi20_index.Find(rel.offset())));
+    }
+    else if constexpr (type == T::R_RISCV_TPREL_HI20)
+    {
+        // the LUI is removed by relaxation
+        if (removed_bytes == 4)
+            return;
+
+        write_utype(loc, state.Get_sym_addr(rel) + A - state.tp);
+    }
+    else if constexpr (type == T::R_RISCV_TPREL_LO12_I || type == T::R_RISCV_TPREL_LO12_S)
+    {
+        int64_t val = state.Get_sym_addr(rel) + A - state.tp;
+
+        if constexpr (type == T::R_RISCV_TPREL_LO12_I)
+            write_itype(loc, val);
+        else
+            write_stype(loc, val);
+
+        // If the variable is at TP ±2 KiB, TP + HI20 is the same as TP, so 
+        // the access is based on tp, the LUI and ADD might have been removed
+        if (nUtil::sign_extend(val, 11) == val)
+            set_rs1(loc, 4); // tp is x4
+    }
+    else if constexpr (type == T::R_RISCV_TPREL_ADD)
+    {
+        // `add rd, rd, tp` is kept as it is, or removed by relaxation
+    }
+    else if constexpr (type == T::R_RISCV_TLSDESC_HI20)
+    {
+        // TLSDESC is relaxed to local-exec, 
+        //
+        //   auipc  tX, <hi20>        ->  <deleted>
+        //   ld     tY, <lo12>(tX)    ->  <deleted>
+        //   addi   a0, tX, <lo12>    ->  lui  a0, <tprel hi20> or <deleted>
+        //   jalr   t0, tY            ->  addi a0, a0, <tprel lo12> or addi a0, zero, <tprel lo12>
+        //
+        // Without relaxation, the AUIPC is left as it is and the load is replaced with a NOP
+    }
+    else if constexpr (type == T::R_RISCV_TLSDESC_LOAD_LO12)
+    {
+        if (removed_bytes == 0)
+            *(uint32_t *)loc = 0x0000'0013; // nop
+    }
+    else if constexpr (type == T::R_RISCV_TLSDESC_ADD_LO12)
+    {
+        if (removed_bytes == 0)
+        {
+            *(uint32_t *)loc = 0x0000'0537; // lui a0, <hi20>
+            write_utype(loc, state.Get_hi20_val(state.Find_paired_hi20(rel)));
+        }
+    }
+    else if constexpr (type == T::R_RISCV_TLSDESC_CALL)
+    {
+        int64_t val = state.Get_hi20_val(state.Find_paired_hi20(rel));
+
+        if (nUtil::sign_extend(val, 11) == val)
+            *(uint32_t *)loc = 0x0000'0513; // addi a0, zero, <lo12>
+        else
+            *(uint32_t *)loc = 0x0005'0513; // addi a0, a0, <lo12>
+        
+        write_itype(loc, val);
+    }
+    else if constexpr (type == T::R_RISCV_HI20)
+    {
+        // the LUI is removed by relaxation
+        if (removed_bytes == 4)
+            return;
+
+        uint64_t val = state.Get_sym_addr(rel) + A;
+        Check_range(val, -(1LL << 31), 1LL << 31);
+        write_utype(loc, val);
+    }
+    else if constexpr (type == T::R_RISCV_LO12_I || type == T::R_RISCV_LO12_S)
+    {
+        uint64_t val = state.Get_sym_addr(rel) + A;
+
+        // Rewrite `lw t1, 0(t0)` with `lw t1, 0(x0)` or `lw t1, <off>(gp)` if the LUI which 
+        // sets t0 is removed, the LUI of the same address is removed only if it's short
+        if (state.Is_rewritten(rel_idx) == true)
+        {
+            uint32_t rs1;
+            [[maybe_unused]] bool is_short = state.Is_short_addr(val, &rs1);
+            assert(is_short == true);
+
+            if (rs1 != 0)
+                val -= state.gp;
+            set_rs1(loc, rs1);
+        }
+
+        if constexpr (type == T::R_RISCV_LO12_I)
+            write_itype(loc, val);
+        else
+            write_stype(loc, val);
+    }
+    else if constexpr (type == T::R_RISCV_ADD8)
+        *loc += state.Get_sym_addr(rel) + A;
+    else if constexpr (type == T::R_RISCV_ADD16)
+        *(uint16_t*)loc += state.Get_sym_addr(rel) + A;
+    else if constexpr (type == T::R_RISCV_ADD32)
+        *(uint32_t*)loc += state.Get_sym_addr(rel) + A;
+    else if constexpr (type == T::R_RISCV_ADD64)
+        *(uint64_t*)loc += state.Get_sym_addr(rel) + A;
+    else if constexpr (type == T::R_RISCV_SUB8)
+        *loc -= state.Get_sym_addr(rel) + A;
+    else if constexpr (type == T::R_RISCV_SUB16)
+        *(uint16_t*)loc -= state.Get_sym_addr(rel) + A;
+    else if constexpr (type == T::R_RISCV_SUB32)
+        *(uint32_t*)loc -= state.Get_sym_addr(rel) + A;
+    else if constexpr (type == T::R_RISCV_SUB64)
+        *(uint64_t*)loc -= state.Get_sym_addr(rel) + A;
+    else if constexpr (type == T::R_RISCV_ALIGN)
+    {
+        // A R_RISCV_ALIGN is followed by a NOP sequence. We need to remove
+        // zero or more bytes so that the instruction after R_RISCV_ALIGN is
+        // aligned to a given alignment boundary.
+        //
+        // We need to guarantee that the NOP sequence is valid after byte
+        // removal (e.g. we can't remove the first 2 bytes of a 4-byte NOP).
+        // For the sake of simplicity, we always rewrite the entire NOP sequence.
+        int64_t padding_bytes = rel.r_addend - removed_bytes;
+        assert((padding_bytes & 1) == 0);
+
+        int64_t i = 0;
+        for (; i <= padding_bytes - 4; i += 4)
+            *(uint32_t *)(loc + i) = 0x0000'0013; // nop
+        if (i < padding_bytes)
+            *(uint16_t *)(loc + i) = 0x0001;      // c.nop
+    }
+    else if constexpr (type == T::R_RISCV_RVC_BRANCH)
+    {
+        uint64_t val = state.Get_sym_addr(rel) + A - P;
+        Check_range(val, -(1 << 8), 1 << 8);
+        write_cbtype(loc, val);
+    }
+    else if constexpr (type == T::R_RISCV_RVC_JUMP)
+    {
+        uint64_t val = state.Get_sym_addr(rel) + A - P;
+        Check_range(val, -(1 << 11), 1 << 11);
+        write_cjtype(loc, val);
+    }
+    else if constexpr (type == T::R_RISCV_SUB6)
+        *loc = (*loc & 0b1100'0000) | ((*loc - state.Get_sym_addr(rel) - A) & 0b0011'1111);
+    else if constexpr (type == T::R_RISCV_SET6)
+        *loc = (*loc & 0b1100'0000) | ((state.Get_sym_addr(rel) + A) & 0b0011'1111);
+    else if constexpr (type == T::R_RISCV_SET8)
+        *loc = state.Get_sym_addr(rel) + A;
+    else if constexpr (type == T::R_RISCV_SET16)
+        *(uint16_t*)loc = state.Get_sym_addr(rel) + A;
+    else if constexpr (type == T::R_RISCV_SET32)
+        *(uint32_t*)loc = state.Get_sym_addr(rel) + A;
+    else if constexpr (type == T::R_RISCV_PLT32 || type == T::R_RISCV_32_PCREL)
+        *(uint32_t*)loc = state.Get_sym_addr(rel) + A - P;
+    else if constexpr (type == T::R_RISCV_SET_ULEB128)
+        nUtil::Overwrite_uleb(loc, state.Get_sym_addr(rel) + A);
+    else if constexpr (type == T::R_RISCV_SUB_ULEB128)
+        nUtil::Overwrite_uleb(loc, nUtil::read_uleb(loc) - state.Get_sym_addr(rel) - A);
+    else
+        static_assert(gDEPENDENT_FALSE<type>, "a kernel is instantiated for a non supported relocation type");
+}
+
+using Reloc_kernel_t = void (*)(Reloc_state &state, const uint32_t *rel_idx_list, std::size_t n);
+
+template<eReloc_type type>
+static void Reloc_kernel(Reloc_state &state, const uint32_t *rel_idx_list, std::size_t n)
+{
+    for(std::size_t i = 0 ; i < n ; i++)
+        Apply_reloc<type>(state, rel_idx_list[i], state.isec.rela_at(rel_idx_list[i]));
+}
+
+static void Reloc_kernel_skip(Reloc_state &state, const uint32_t *rel_idx_list, std::size_t n)
+{
+    // R_RISCV_NONE and R_RISCV_RELAX, nothing to do
+}
+
+static void Reloc_kernel_unsupported(Reloc_state &state, const uint32_t *rel_idx_list, std::size_t n)
+{
+    FATALF("non supported link type %lu", state.isec.rela_at(rel_idx_list[0]).type());
+}
+
+constexpr std::size_t gRELOC_TYPE_CNT = (std::size_t)eReloc_type::R_RISCV_TLSDESC_CALL + 1;
+
+constexpr bool Is_supported_reloc(eReloc_type type)
+{
+    using T = eReloc_type;
+
+    switch (type)
+    {
+        case T::R_RISCV_32:             case T::R_RISCV_64:
+        case T::R_RISCV_BRANCH:         case T::R_RISCV_JAL:
+        case T::R_RISCV_CALL:           case T::R_RISCV_CALL_PLT:
+        case T::R_RISCV_PCREL_HI20:     case T::R_RISCV_PCREL_LO12_I:
+        case T::R_RISCV_PCREL_LO12_S:   case T::R_RISCV_HI20:
+        case T::R_RISCV_LO12_I:         case T::R_RISCV_LO12_S:
+        case T::R_RISCV_ADD8:           case T::R_RISCV_ADD16:
+        case T::R_RISCV_ADD32:          case T::R_RISCV_ADD64:
+        case T::R_RISCV_SUB8:           case T::R_RISCV_SUB16:
+        case T::R_RISCV_SUB32:          case T::R_RISCV_SUB64:
+        case T::R_RISCV_ALIGN:          case T::R_RISCV_RVC_BRANCH:
+        case T::R_RISCV_RVC_JUMP:       case T::R_RISCV_SUB6:
+        case T::R_RISCV_SET6:           case T::R_RISCV_SET8:
+        case T::R_RISCV_SET16:          case T::R_RISCV_SET32:
+        case T::R_RISCV_PLT32:          case T::R_RISCV_32_PCREL:
+        case T::R_RISCV_SET_ULEB128:    case T::R_RISCV_SUB_ULEB128:
+        case T::R_RISCV_TLS_GD_HI20:    case T::R_RISCV_TLS_GOT_HI20:
+        case T::R_RISCV_GOT_HI20:
+        case T::R_RISCV_TPREL_HI20:     case T::R_RISCV_TPREL_LO12_I:
+        case T::R_RISCV_TPREL_LO12_S:   case T::R_RISCV_TPREL_ADD:
+        case T::R_RISCV_TLSDESC_HI20:   case T::R_RISCV_TLSDESC_LOAD_LO12:
+        case T::R_RISCV_TLSDESC_ADD_LO12: case T::R_RISCV_TLSDESC_CALL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Jump tables, .init_array and pointer tables are long runs of R_RISCV_64/32 
+// relocations at consecutive offsets. S and A of a run are gathered into 
+// a batch, then S + A of the batch is computed and stored with vector instructions.
+constexpr std::size_t gDATA_RELOC_BATCH_SIZE = 16;
+
+// dst[i] = S[i] + A[i] for i in [0, n), dst may be unaligned
+template<typename word_t>
+static void Add_and_store(uint8_t *dst, const word_t *S, const word_t *A, std::size_t n)
+{
+    std::size_t i = 0;
+
+#if defined(__SSE2__)
+    constexpr std::size_t lane_cnt = 16 / sizeof(word_t);
+
+    for(; i + lane_cnt <= n ; i += lane_cnt)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*)(S + i));
+        __m128i a = _mm_loadu_si128((const __m128i*)(A + i));
+        
+        if constexpr (sizeof(word_t) == 8)
+            _mm_storeu_si128((__m128i*)(dst + i * sizeof(word_t)), _mm_add_epi64(s, a));
+        else
+            _mm_storeu_si128((__m128i*)(dst + i * sizeof(word_t)), _mm_add_epi32(s, a));
+    }
+#endif
+
+    for(; i < n ; i++)
+    {
+        word_t val = S[i] + A[i];
+        memcpy(dst + i * sizeof(word_t), &val, sizeof(word_t));
+    }
+}
+
+template<eReloc_type type, bool is_alloc>
+static void Data_reloc_kernel(Reloc_state &state, const uint32_t *rel_idx_list, std::size_t n)
+{
+    static_assert(type == eReloc_type::R_RISCV_64 || type == eReloc_type::R_RISCV_32);
+
+    using word_t = std::conditional_t<type == eReloc_type::R_RISCV_64, uint64_t, uint32_t>;
+
+    word_t S[gDATA_RELOC_BATCH_SIZE];
+    word_t A[gDATA_RELOC_BATCH_SIZE];
+
+    for(std::size_t i = 0 ; i < n ;)
+    {
+        uint64_t run_offset = state.Get_out_offset(rel_idx_list[i], state.isec.rela_at(rel_idx_list[i]).offset());
+        std::size_t cnt = 0;
+
+        for(; i < n && cnt < gDATA_RELOC_BATCH_SIZE ; i++, cnt++)
+        {
+            nELF_util::ELF_Rel rel = state.isec.rela_at(rel_idx_list[i]);
+
+            if (state.Get_out_offset(rel_idx_list[i], rel.offset()) != run_offset + cnt * sizeof(word_t))
+                break;
+
+            if constexpr (is_alloc == true)
+                S[cnt] = state.Get_sym_addr(rel);
+            else
+                S[cnt] = state.Get_non_alloc_sym_addr(rel);
+            
+            A[cnt] = rel.r_addend;
+        }
+
+        Add_and_store(state.base + run_offset, S, A, cnt);
+    }
+}
+
+template<std::size_t type>
+constexpr Reloc_kernel_t Get_reloc_kernel()
+{
+    if constexpr ((eReloc_type)type == eReloc_type::R_RISCV_NONE || (eReloc_type)type == eReloc_type::R_RISCV_RELAX)
+        return &Reloc_kernel_skip;
+    else if constexpr ((eReloc_type)type == eReloc_type::R_RISCV_64 || (eReloc_type)type == eReloc_type::R_RISCV_32)
+        return &Data_reloc_kernel<(eReloc_type)type, true>;
+    else if constexpr (Is_supported_reloc((eReloc_type)type))
+        return &Reloc_kernel<(eReloc_type)type>;
+    else
+        return &Reloc_kernel_unsupported;
+}
+
+template<std::size_t... type>
+constexpr std::array<Reloc_kernel_t, sizeof...(type)> Make_reloc_kernel_table(std::index_sequence<type...>)
+{
+    return {Get_reloc_kernel<type>()...};
+}
+
+// relocation kernels indexed by relocation type
+static constexpr std::array<Reloc_kernel_t, gRELOC_TYPE_CNT> gRELOC_KERNEL_TABLE 
+    = Make_reloc_kernel_table(std::make_index_sequence<gRELOC_TYPE_CNT>{});
+
+// Relocations of non-alloc sections are data relocations, there is no instruction 
+// to patch and nothing to pair, so a kernel is just a load, an add and a store.
+template<eReloc_type type>
+static void Non_alloc_reloc_kernel(Reloc_state &state, const uint32_t *rel_idx_list, std::size_t n)
+{
+    using T = eReloc_type;
+
+    for(std::size_t i = 0 ; i < n ; i++)
+    {
+        nELF_util::ELF_Rel rel = state.isec.rela_at(rel_idx_list[i]);
+        uint8_t *loc = state.base + rel.offset();
+        uint64_t val = state.Get_non_alloc_sym_addr(rel) + rel.r_addend;
+
+        if constexpr (type == T::R_RISCV_SET32)
+            *(uint32_t*)loc = val;
+        else if constexpr (type == T::R_RISCV_ADD8)
+            *loc += val;
+        else if constexpr (type == T::R_RISCV_ADD16)
+            *(uint16_t*)loc += val;
+        else if constexpr (type == T::R_RISCV_ADD32)
+            *(uint32_t*)loc += val;
+        else if constexpr (type == T::R_RISCV_ADD64)
+            *(uint64_t*)loc += val;
+        else if constexpr (type == T::R_RISCV_SUB8)
+            *loc -= val;
+        else if constexpr (type == T::R_RISCV_SUB16)
+            *(uint16_t*)loc -= val;
+        else if constexpr (type == T::R_RISCV_SUB32)
+            *(uint32_t*)loc -= val;
+        else if constexpr (type == T::R_RISCV_SUB64)
+            *(uint64_t*)loc -= val;
+        else if constexpr (type == T::R_RISCV_SUB6)
+            *loc = (*loc & 0b1100'0000) | ((*loc - val) & 0b0011'1111);
+        else if constexpr (type == T::R_RISCV_SET6)
+            *loc = (*loc & 0b1100'0000) | (val & 0b0011'1111);
+        else if constexpr (type == T::R_RISCV_SET8)
+            *loc = val;
+        else if constexpr (type == T::R_RISCV_SET16)
+            *(uint16_t*)loc = val;
+        else if constexpr (type == T::R_RISCV_SET_ULEB128)
+            nUtil::Overwrite_uleb(loc, val);
+        else if constexpr (type == T::R_RISCV_SUB_ULEB128)
+            nUtil::Overwrite_uleb(loc, nUtil::read_uleb(loc) - val);
+        else
+            static_assert(gDEPENDENT_FALSE<type>, "a kernel is instantiated for a non supported relocation type");
+    }
+}
+
+constexpr bool Is_supported_non_alloc_reloc(eReloc_type type)
+{
+    using T = eReloc_type;
+
+    switch (type)
+    {
+        case T::R_RISCV_32:             case T::R_RISCV_64:
+        case T::R_RISCV_ADD8:           case T::R_RISCV_ADD16:
+        case T::R_RISCV_ADD32:          case T::R_RISCV_ADD64:
+        case T::R_RISCV_SUB8:           case T::R_RISCV_SUB16:
+        case T::R_RISCV_SUB32:          case T::R_RISCV_SUB64:
+        case T::R_RISCV_SUB6:           case T::R_RISCV_SET6:
+        case T::R_RISCV_SET8:           case T::R_RISCV_SET16:
+        case T::R_RISCV_SET32:
+        case T::R_RISCV_SET_ULEB128:    case T::R_RISCV_SUB_ULEB128:
+            return true;
+        default:
+            return false;
+    }
+}
+
+template<std::size_t type>
+constexpr Reloc_kernel_t Get_non_alloc_reloc_kernel()
+{
+    if constexpr ((eReloc_type)type == eReloc_type::R_RISCV_NONE)
+        return &Reloc_kernel_skip;
+    else if constexpr ((eReloc_type)type == eReloc_type::R_RISCV_64 || (eReloc_type)type == eReloc_type::R_RISCV_32)
+        return &Data_reloc_kernel<(eReloc_type)type, false>;
+    else if constexpr (Is_supported_non_alloc_reloc((eReloc_type)type))
+        return &Non_alloc_reloc_kernel<(eReloc_type)type>;
+    else
+        return &Reloc_kernel_unsupported;
+}
+
+template<std::size_t... type>
+constexpr std::array<Reloc_kernel_t, sizeof...(type)> Make_non_alloc_reloc_kernel_table(std::index_sequence<type...>)
+{
+    return {Get_non_alloc_reloc_kernel<type>()...};
+}
+
+// relocation kernels of non-alloc sections indexed by relocation type
+static constexpr std::array<Reloc_kernel_t, gRELOC_TYPE_CNT> gNON_ALLOC_RELOC_KERNEL_TABLE 
+    = Make_non_alloc_reloc_kernel_table(std::make_index_sequence<gRELOC_TYPE_CNT>{});
+
+// SET and SUB relocations may be applied to the same location as a pair,
+// so their relative order has to be kept.
+static bool Is_order_dependent(std::size_t type)
+{
+    using T = eReloc_type;
+
+    switch ((T)type)
+    {
+        case T::R_RISCV_SUB6:  case T::R_RISCV_SET6:
+        case T::R_RISCV_SUB8:  case T::R_RISCV_SET8:
+        case T::R_RISCV_SUB16: case T::R_RISCV_SET16:
+        case T::R_RISCV_SUB32: case T::R_RISCV_SET32:
+        case T::R_RISCV_SET_ULEB128:
+        case T::R_RISCV_SUB_ULEB128:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Group relocations [rel_begin, rel_end) by type with a counting sort, then
+// call each kernel on the run of relocations of its type, so that the hot loop 
+// of a kernel does not branch on relocation types. The relative order of 
+// relocations in a group is kept. Order dependent relocations share one group 
+// which is still split into runs of the same type.
+static void Apply_relocations(Reloc_state &state, 
+                              const std::array<Reloc_kernel_t, gRELOC_TYPE_CNT> &kernel_table,
+                              std::size_t rel_begin, 
+                              std::size_t rel_end)
+{
+    // the bucket of order dependent relocations
+    constexpr std::size_t ordered_bucket = gRELOC_TYPE_CNT;
+
+    std::array<uint32_t, gRELOC_TYPE_CNT + 2> bucket_start{};
+
+    auto get_bucket = [](std::size_t type) 
+    {
+        return Is_order_dependent(type) ? ordered_bucket : type;
+    };
+
+    for(std::size_t rel_idx = rel_begin ; rel_idx < rel_end ; rel_idx++)
+    {
+        std::size_t type = state.isec.rela_at(rel_idx).type();
+
+        if (type >= gRELOC_TYPE_CNT)
+            FATALF("non supported link type %lu", type);
+
+        bucket_start[get_bucket(type) + 1]++;
+    }
+
+    for(std::size_t i = 1 ; i < bucket_start.size() ; i++)
+        bucket_start[i] += bucket_start[i - 1];
+
+    state.order.resize(rel_end - rel_begin);
+    
+    auto bucket_end = bucket_start;
+
+    for(std::size_t rel_idx = rel_begin ; rel_idx < rel_end ; rel_idx++)
+        state.order[bucket_end[get_bucket(state.isec.rela_at(rel_idx).type())]++] = rel_idx;
+
+    for(std::size_t type = 0 ; type < gRELOC_TYPE_CNT ; type++)
+    {
+        if (bucket_start[type] == bucket_end[type])
+            continue;
+
+        kernel_table[type](state, &state.order[bucket_start[type]], bucket_end[type] - bucket_start[type]);
+    }
+
+    for(std::size_t begin = bucket_start[ordered_bucket], end ; begin < bucket_end[ordered_bucket] ; begin = end)
+    {
+        std::size_t type = state.isec.rela_at(state.order[begin]).type();
+
+        for(end = begin + 1 ; end < bucket_end[ordered_bucket] && state.isec.rela_at(state.order[end]).type() == type ; end++);
+
+        kernel_table[type](state, &state.order[begin], end - begin);
+    }
+}
+
+// Relocations are applied to a copied input section while it's still hot in the cache. 
+// An input section is copied in tiles, and a tile is patched by its relocations
+// right after it's copied. Relocations are sorted by r_offset, so the relocations
+// of a tile are a contiguous range.
+constexpr std::size_t gRELOC_TILE_SIZE = 16 * 1024;
+
+// relocation free data larger than this is copied with non-temporal stores
+constexpr std::size_t gSTREAM_COPY_THRESHOLD = 64 * 1024;
+
+// the end of bytes read or written by a relocation, relative to the start of the input section
+static uint64_t Get_reloc_reach(const nELF_util::ELF_Rel &rel)
+{
+    // the longest patched sequence of an instruction relocation is 8 bytes (auipc + jalr),
+    // and a ULEB128 value is at most 10 bytes
+    constexpr uint64_t max_patch_size = 16;
+
+    if (rel.type() == (std::size_t)eReloc_type::R_RISCV_ALIGN)
+        return rel.offset() + std::max<uint64_t>(max_patch_size, rel.r_addend);
+    
+    return rel.offset() + max_patch_size;
+}
+
+static void Copy_and_relocate(Reloc_state &state, const std::array<Reloc_kernel_t, gRELOC_TYPE_CNT> &kernel_table)
+{
+    const Input_section &isec = state.isec;
+    uint64_t size = isec.shdr().sh_size;
+
+    // there is no data of a NOBITS section in its file
+    if (isec.shdr().sh_type == SHT_NOBITS)
+    {
+        memset(state.base, 0, size);
+        Apply_relocations(state, kernel_table, 0, isec.rel_count());
+        return;
+    }
+
+    const char *src = isec.data.data();
+
+    // A relaxed section is copied piece by piece, bytes removed at a relocation are skipped.
+    // The rewritten instruction of a relocation is written by its kernel.
+    if (isec.r_deltas.empty() == false)
+    {
+        uint8_t *dst = state.base;
+        uint64_t pos = 0;
+
+        for(std::size_t i = 0 ; i < isec.rel_count() ; i++)
+        {
+            uint64_t removed_bytes = state.Get_removed_bytes(i);
+            if (removed_bytes == 0)
+                continue;
+
+            uint64_t offset = isec.rela_at(i).offset();
+            memcpy(dst, src + pos, offset - pos);
+            dst += offset - pos;
+            pos = offset + removed_bytes;
+        }
+
+        memcpy(dst, src + pos, size - pos);
+        Apply_relocations(state, kernel_table, 0, isec.rel_count());
+        return;
+    }
+
+    uint64_t copied = 0;
+    std::size_t rel_idx = 0;
+
+    while (copied < size)
+    {
+        uint64_t next_rel_offset = (rel_idx < isec.rel_count()) ? std::min(isec.rela_at(rel_idx).offset(), size) : size;
+
+        if (next_rel_offset - copied >= gSTREAM_COPY_THRESHOLD)
+        {
+            nUtil::Stream_copy(state.base + copied, src + copied, next_rel_offset - copied);
+            copied = next_rel_offset;
+            continue;
+        }
+
+        uint64_t tile_end = std::min(size, copied + gRELOC_TILE_SIZE);
+        std::size_t rel_end = rel_idx;
+
+        // a relocation at the end of a tile may patch bytes of the next tile, extend the tile for it 
+        for(; rel_end < isec.rel_count() && isec.rela_at(rel_end).offset() < tile_end ; rel_end++)
+            tile_end = std::max(tile_end, std::min(size, Get_reloc_reach(isec.rela_at(rel_end))));
+
+        memcpy(state.base + copied, src + copied, tile_end - copied);
+        Apply_relocations(state, kernel_table, rel_idx, rel_end);
+        
+        copied = tile_end;
+        rel_idx = rel_end;
+    }
+
+    Apply_relocations(state, kernel_table, rel_idx, isec.rel_count());
+}
+
+void nRelocation::Reloc_alloc(Linking_context &ctx, Output_section &osec, std::size_t isec_idx)
+{
+    Reloc_state state(ctx, osec, isec_idx);
+    state.hi20_index = Hi20_index(state.isec);
+
+    Copy_and_relocate(state, gRELOC_KERNEL_TABLE);
+}
+
+void nRelocation::Reloc_non_alloc(Linking_context &ctx, Output_section &osec, std::size_t isec_idx)
+{
+    Reloc_state state(ctx, osec, isec_idx);
+
+    Copy_and_relocate(state, gNON_ALLOC_RELOC_KERNEL_TABLE);
+}
+
+// Bytes removed at each relocation are decided on the layout of the previous pass.
+// A call relaxed before is checked again on the current layout, C.J which doesn't fit 
+// any more becomes JAL, and JAL is kept since a thunk extends its range. A removed LUI 
+// comes back if its address moves away from x0 and gp. The other relaxations are kept.
+void nRelocation::Relax_section(Linking_context &ctx, const Output_section &osec, std::size_t isec_idx, bool relax, 
+                                std::vector<uint32_t> &r_deltas, std::vector<uint32_t> &rewritten_rel_list)
+{
+    using T = eReloc_type;
+
+    Reloc_state state(ctx, osec, isec_idx);
+    state.hi20_index = Hi20_index(state.isec);
+    const Input_section &isec = state.isec;
+    bool use_rvc = state.file.src().elf_hdr().e_flags & gRISC_V_RVC_MASK;
+
+    r_deltas.resize(isec.rel_count() + 1);
+    rewritten_rel_list.clear();
+    uint32_t delta = 0;
+
+    // the R_RISCV_HI20 whose LUI sets each register and is removed, or -1. A LO12 is paired with 
+    // the HI20 of its base register if they have the same symbol and addend
+    std::array<std::size_t, 32> removed_lui_of_reg;
+    removed_lui_of_reg.fill(-1);
+
+    // a general-dynamic sequence sets a0 by R_RISCV_TLS_GD_HI20 and its PCREL_LO12, 
+    // then calls __tls_get_addr, no other call is between them since a call clobbers a0
+    bool is_gd_pending = false;
+
+    for(std::size_t i = 0 ; i < isec.rel_count() ; i++)
+    {
+        nELF_util::ELF_Rel rel = isec.rela_at(i);
+        r_deltas[i] = delta;
+
+        if (rel.type() == (std::size_t)T::R_RISCV_ALIGN)
+        {
+            // The total bytes of NOPs is stored to r_addend, so the next
+            // instruction is r_addend away.
+            uint64_t loc = state.isec_addr + rel.offset() - delta;
+            uint64_t alignment = 1;
+            while (alignment <= (uint64_t)rel.r_addend)
+                alignment <<= 1;
+
+            uint64_t padding_bytes = nUtil::align_to(loc, alignment) - loc;
+            if (padding_bytes <= (uint64_t)rel.r_addend)
+                delta += rel.r_addend - padding_bytes;
+            continue;
+        }
+
+        if (rel.type() == (std::size_t)T::R_RISCV_LO12_I || rel.type() == (std::size_t)T::R_RISCV_LO12_S)
+        {
+            uint32_t rs1 = (*(uint32_t *)(isec.data.data() + rel.offset()) >> 15) & 0b11111;
+            std::size_t hi20_idx = removed_lui_of_reg[rs1];
+
+            if (   hi20_idx != (std::size_t)-1 
+                && isec.rela_at(hi20_idx).sym() == rel.sym() 
+                && isec.rela_at(hi20_idx).r_addend == rel.r_addend)
+                rewritten_rel_list.push_back(i);
+            continue;
+        }
+
+        if (rel.type() == (std::size_t)T::R_RISCV_HI20)
+            removed_lui_of_reg[state.Get_rd(rel.offset())] = -1;
+
+        if (rel.type() == (std::size_t)T::R_RISCV_TLS_GD_HI20)
+        {
+            is_gd_pending = state.Get_rd(rel.offset()) == 10; // a0 is x10
+            continue;
+        }
+
+        if (rel.type() == (std::size_t)T::R_RISCV_CALL || rel.type() == (std::size_t)T::R_RISCV_CALL_PLT)
+        {
+            bool is_gd_call = is_gd_pending && Is_tls_get_addr(state, rel);
+            is_gd_pending = false;
+
+            if (is_gd_call)
+            {
+                // it's rewritten to `add a0, a0, tp`, and the JALR is removed if it can be relaxed
+                rewritten_rel_list.push_back(i);
+                if (relax && i + 1 < isec.rel_count() && isec.rela_at(i + 1).type() == (std::size_t)T::R_RISCV_RELAX)
+                    delta += 4;
+                continue;
+            }
+        }
+
+        // Handling other relocations is optional.
+        if (   relax == false 
+            || i + 1 == isec.rel_count() 
+            || isec.rela_at(i + 1).type() != (std::size_t)T::R_RISCV_RELAX)
+            continue;
+
+        Symbol *sym = state.file.symbol_list[rel.sym()];
+
+        // Linker-synthesized symbols are absolute symbols and their values are 
+        // fixed after the layout, so absolute symbols are not relaxed, 
+        // neither are undefined weak symbols.
+        if (   sym == nullptr 
+            || (sym->piece() == nullptr && nELF_util::Is_sym_abs(sym->elf_sym()))
+            || nELF_util::Is_sym_undef(sym->elf_sym()))
+            continue;
+
+        uint32_t removed_bytes = 0;
+        uint32_t prev_removed_bytes = state.Get_removed_bytes(i);
+
+        switch (rel.type())
+        {
+            case (std::size_t)T::R_RISCV_CALL:
+            case (std::size_t)T::R_RISCV_CALL_PLT:
+            {
+                // These relocations refer to an AUIPC + JALR instruction pair to
+                // allow to jump to anywhere in PC ± 2 GiB. If the jump target is
+                // close enough to PC, we can use C.J or JAL instead.
+                int64_t dist = state.Get_sym_addr(rel) + rel.r_addend - (state.isec_addr + state.Get_out_offset(i, rel.offset()));
+                uint32_t rd = state.Get_rd(rel.offset() + 4);
+
+                if (Get_table_jump_index(state, rel, rd) != -1)
+                    removed_bytes = 6; // cm.jt or cm.jalt
+                else if ((dist & 1) == 0)
+                {
+                    if (rd == 0 && use_rvc && nUtil::sign_extend(dist, 11) == dist)
+                        removed_bytes = 6; // c.j
+                    else if (nUtil::sign_extend(dist, 20) == dist)
+                        removed_bytes = 4; // jal
+                }
+
+                // A relaxed call which doesn't fit the layout any more becomes JAL and stays JAL, 
+                // JAL out of range jumps through a thunk, which is only for a call without an addend
+                if (prev_removed_bytes != 0 && removed_bytes != prev_removed_bytes)
+                    removed_bytes = (removed_bytes == 0 && rel.r_addend != 0) ? 0 : 4;
+
+                delta += removed_bytes;
+            }
+            continue;
+
+            case (std::size_t)T::R_RISCV_HI20:
+            {
+                // If the address is accessible relative to the zero register or gp,
+                // the LUI is removed and its LO12 instructions use that register instead.
+                // It's decided on each layout, the LUI comes back if the address moves away.
+                uint32_t rs1;
+                if (state.Is_short_addr(state.Get_sym_addr(rel) + rel.r_addend, &rs1) == true)
+                {
+                    removed_bytes = 4;
+                    removed_lui_of_reg[state.Get_rd(rel.offset())] = i;
+                }
+
+                delta += removed_bytes;
+            }
+            continue;
+
+            case (std::size_t)T::R_RISCV_TPREL_HI20:
+            case (std::size_t)T::R_RISCV_TPREL_ADD:
+            {
+                // `lui rd, <hi20>` and `add rd, rd, tp` are removed if the variable 
+                // is at TP ±2 KiB, the access is based on tp directly
+                int64_t val = state.Get_sym_addr(rel) + rel.r_addend - state.tp;
+                if (nUtil::sign_extend(val, 11) == val)
+                    removed_bytes = 4;
+            }
+            break;
+
+            case (std::size_t)T::R_RISCV_TLSDESC_HI20:
+            case (std::size_t)T::R_RISCV_TLSDESC_LOAD_LO12:
+                removed_bytes = 4;
+            break;
+
+            case (std::size_t)T::R_RISCV_TLSDESC_ADD_LO12:
+            {
+                int64_t val = state.Get_hi20_val(state.Find_paired_hi20(rel));
+                if (nUtil::sign_extend(val, 11) == val)
+                    removed_bytes = 4;
+            }
+            break;
+
+            default:
+            break;
+        }
+
+        delta += std::max<uint32_t>(removed_bytes, prev_removed_bytes);
+    }
+
+    r_deltas[isec.rel_count()] = delta;
+}